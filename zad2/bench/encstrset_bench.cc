@@ -0,0 +1,235 @@
+// Mikrobenchmark biblioteki encstrset.
+//
+// Dla każdej kombinacji rozmiaru zbioru, długości napisu i długości klucza
+// mierzy przepustowość oraz percentyle opóźnień operacji insert, test (dla
+// elementów obecnych i nieobecnych), remove i copy (powtarzanej kilka razy),
+// czas pełnego przejrzenia zbioru kursorem (scan) i eksportu (export), a także
+// RSS procesu po zbudowaniu zbioru. Wyniki trafiają na stdout, a diagnostyka biblioteki
+// (w wersji z włączonym debugowaniem) na stderr, który warto przekierować:
+//
+//     ./encstrset_bench_debug 2>/dev/null
+//
+// Użycie: encstrset_bench [--quick] [--bloom] [--no-echo]
+//   --quick    mniejsza macierz parametrów (do szybkiego sprawdzenia zmian),
+//   --bloom    włącza filtr Blooma w mierzonych zbiorach,
+//   --no-echo  diagnostyka trafia tylko do bufora zdarzeń (encstrset_trace_echo).
+
+#include "../encstrset.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ::jnp1;
+
+namespace {
+
+    using bench_clock = std::chrono::steady_clock;
+
+    struct config_t {
+        size_t set_size;
+        size_t value_length;
+        size_t key_length;
+    };
+
+    // Zwraca aktualny RSS procesu w KiB (0, jeśli nie da się go odczytać).
+    long current_rss_kib() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmRSS:") == 0)
+                return std::stol(line.substr(6));
+        }
+        return 0;
+    }
+
+    // Generuje [count] różnych napisów długości [length] bez znaku '\0'.
+    // Różnowartościowość zapewnia zakodowany na początku numer napisu.
+    std::vector<std::string> make_strings(size_t count, size_t length,
+                                          std::mt19937_64 &rng, char tag) {
+        std::uniform_int_distribution<int> letter('a', 'z');
+        std::vector<std::string> result;
+        result.reserve(count);
+
+        for (size_t i = 0; i < count; i++) {
+            std::string s(1, tag);
+            for (size_t n = i; n > 0; n /= 26)
+                s += char('a' + n % 26);
+            s += '.';
+            while (s.size() < length)
+                s += char(letter(rng));
+            result.push_back(std::move(s));
+        }
+
+        return result;
+    }
+
+    // Zbiera czasy pojedynczych wywołań i wypisuje ich podsumowanie.
+    class latency_recorder_t {
+    private:
+        std::vector<double> samples_ns;
+
+    public:
+        explicit latency_recorder_t(size_t expected) {
+            samples_ns.reserve(expected);
+        }
+
+        template<typename F>
+        void measure(F f) {
+            auto start = bench_clock::now();
+            f();
+            auto stop = bench_clock::now();
+            samples_ns.push_back(
+                    std::chrono::duration<double, std::nano>(stop - start).count());
+        }
+
+        void report(const char *operation, const config_t &config) {
+            if (samples_ns.empty())
+                return;
+
+            double total = 0;
+            for (double sample : samples_ns)
+                total += sample;
+            std::sort(samples_ns.begin(), samples_ns.end());
+
+            auto percentile = [&](double p) {
+                return samples_ns[size_t(p * double(samples_ns.size() - 1))];
+            };
+
+            std::printf("%-12s %9zu %5zu %5zu %12.0f %9.0f %9.0f %9.0f %10.0f\n",
+                        operation, config.set_size, config.value_length,
+                        config.key_length,
+                        double(samples_ns.size()) / total * 1e9,
+                        percentile(0.5), percentile(0.9), percentile(0.99),
+                        samples_ns.back());
+        }
+    };
+
+    void run(const config_t &config, bool bloom) {
+        std::mt19937_64 rng(config.set_size * 1000003 + config.value_length * 31 +
+                            config.key_length);
+        std::vector<std::string> values =
+                make_strings(config.set_size, config.value_length, rng, 'v');
+        std::vector<std::string> absent =
+                make_strings(config.set_size, config.value_length, rng, 'x');
+        std::string key = make_strings(1, config.key_length, rng, 'k')[0]
+                .substr(0, config.key_length);
+
+        long rss_before = current_rss_kib();
+        unsigned long id = encstrset_new();
+        if (bloom)
+            encstrset_set_bloom(id, true);
+
+        latency_recorder_t insert(values.size());
+        for (const std::string &value : values)
+            insert.measure([&] { encstrset_insert(id, value.c_str(), key.c_str()); });
+        long rss_after = current_rss_kib();
+
+        latency_recorder_t test_present(values.size());
+        for (const std::string &value : values)
+            test_present.measure([&] { encstrset_test(id, value.c_str(), key.c_str()); });
+
+        latency_recorder_t test_absent(absent.size());
+        for (const std::string &value : absent)
+            test_absent.measure([&] { encstrset_test(id, value.c_str(), key.c_str()); });
+
+        // Pojedynczy pomiar kopii to dla małych zbiorów głównie szum zegara
+        // i koszt pierwszych odwołań do stron, więc kopię powtarzamy, aż
+        // obejmie łącznie ok. 2 * 10^6 elementów. Niepusty zbiór docelowy
+        // wymusza rzeczywiste kopiowanie zamiast współdzielenia.
+        size_t copy_repetitions =
+                std::clamp<size_t>(2000000 / config.set_size, 5, 200);
+        latency_recorder_t copy(copy_repetitions);
+        for (size_t i = 0; i < copy_repetitions; i++) {
+            unsigned long copy_id = encstrset_new();
+            encstrset_insert(copy_id, "", nullptr);
+            copy.measure([&] { encstrset_copy(id, copy_id); });
+            encstrset_delete(copy_id);
+        }
+
+        // Pełne przejrzenie zbioru kursorem i eksport do bufora.
+        latency_recorder_t scan(1);
+        size_t scanned_bytes = 0;
+        scan.measure([&] {
+            encstrset_cursor *cursor = encstrset_cursor_open(id);
+            const char *data;
+            size_t length;
+            while (encstrset_cursor_next(cursor, &data, &length))
+                scanned_bytes += length;
+            encstrset_cursor_close(cursor);
+        });
+
+        latency_recorder_t export_all(1);
+        std::vector<char> buffer(encstrset_export(id, nullptr, 0));
+        export_all.measure([&] { encstrset_export(id, buffer.data(), buffer.size()); });
+
+        latency_recorder_t remove(values.size());
+        for (const std::string &value : values)
+            remove.measure([&] { encstrset_remove(id, value.c_str(), key.c_str()); });
+
+        encstrset_delete(id);
+
+        insert.report("insert", config);
+        test_present.report("test_present", config);
+        test_absent.report("test_absent", config);
+        remove.report("remove", config);
+        copy.report("copy", config);
+        scan.report("scan", config);
+        export_all.report("export", config);
+        std::printf("%-12s %9zu %5zu %5zu %12ld KiB\n", "rss_delta",
+                    config.set_size, config.value_length, config.key_length,
+                    rss_after - rss_before);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool quick = false;
+    bool bloom = false;
+    bool echo = true;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else if (std::strcmp(argv[i], "--bloom") == 0) {
+            bloom = true;
+        } else if (std::strcmp(argv[i], "--no-echo") == 0) {
+            echo = false;
+        } else {
+            std::fprintf(stderr, "usage: %s [--quick] [--bloom] [--no-echo]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<size_t> set_sizes = {1000, 100000, 1000000};
+    std::vector<size_t> value_lengths = {8, 24, 128};
+    std::vector<size_t> key_lengths = {1, 16};
+    if (quick) {
+        set_sizes = {1000, 100000};
+        value_lengths = {16};
+        key_lengths = {4};
+    }
+
+    encstrset_trace_echo(echo);
+
+#ifdef NDEBUG
+    std::printf("# encstrset benchmark, debug off%s\n", bloom ? ", bloom on" : "");
+#else
+    std::printf("# encstrset benchmark, debug on%s%s\n", bloom ? ", bloom on" : "",
+                echo ? "" : ", no echo");
+#endif
+    std::printf("%-12s %9s %5s %5s %12s %9s %9s %9s %10s\n", "operation",
+                "set_size", "value", "key", "ops/s", "p50_ns", "p90_ns",
+                "p99_ns", "max_ns");
+
+    for (size_t set_size : set_sizes) {
+        for (size_t value_length : value_lengths) {
+            for (size_t key_length : key_lengths)
+                run({set_size, value_length, key_length}, bloom);
+        }
+    }
+}
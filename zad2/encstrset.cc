@@ -2,13 +2,24 @@
 
 #include <iostream>
 #include <unordered_set>
-#include <unordered_map>
 #include <string>
 #include <optional>
 #include <functional>
+#include <memory>
 #include <cstring>
 #include <sstream>
 #include <iomanip>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -18,42 +29,548 @@ static const bool debug_enabled = false;
 static const bool debug_enabled = true;
 #endif
 
-#define debug_stream if (!debug_enabled) {} else cerr << __func__
 
 namespace {
 
-    using encrypted_string_t = string;
-    using encrypted_set_t = unordered_set<encrypted_string_t>;
+    // Szyfr (zaszyfrowany ciąg znaków, może zawierać '\0'). Szyfry krótsze
+    // niż inline_capacity + 1 bajtów są trzymane w samym obiekcie, a dłuższe
+    // na stercie. Ostatni bajt obiektu to prefiks długości: dla szyfru
+    // w obiekcie inline_capacity - długość, a dla szyfru na stercie
+    // heap_tag; wtedy na początku obiektu leżą wskaźnik i długość.
+    class cipher_t {
+    private:
+        static constexpr size_t object_size = 24;
+        static constexpr size_t inline_capacity = object_size - 1;
+        static constexpr unsigned char heap_tag = 0xff;
 
-    // Zmienne globalne.
+        alignas(char *) char storage[object_size];
+
+        [[nodiscard]] bool is_inline() const noexcept {
+            return uint8_t(storage[inline_capacity]) != heap_tag;
+        }
+
+        [[nodiscard]] char *heap_data() const noexcept {
+            char *data;
+            memcpy(&data, storage, sizeof(data));
+            return data;
+        }
+
+        [[nodiscard]] size_t heap_size() const noexcept {
+            size_t size;
+            memcpy(&size, storage + sizeof(char *), sizeof(size));
+            return size;
+        }
+
+        // Przygotowuje miejsce na szyfr długości [size] i zwraca wskaźnik na
+        // nie. Obiekt nie może trzymać danych na stercie.
+        char *allocate(size_t size) {
+            if (size <= inline_capacity) {
+                storage[inline_capacity] = char(inline_capacity - size);
+                return storage;
+            }
+
+            char *data = new char[size];
+            memcpy(storage, &data, sizeof(data));
+            memcpy(storage + sizeof(char *), &size, sizeof(size));
+            storage[inline_capacity] = char(heap_tag);
+            return data;
+        }
+
+        void release() noexcept {
+            if (!is_inline())
+                delete[] heap_data();
+        }
 
-    unordered_map<unsigned long, encrypted_set_t> &encrypted_sets() {
-        static auto *result = new unordered_map<unsigned long, encrypted_set_t>();
+    public:
+        cipher_t() noexcept {
+            storage[inline_capacity] = char(inline_capacity);
+        }
+
+        cipher_t(const char *data, size_t size) {
+            memcpy(allocate(size), data, size);
+        }
+
+        // Tworzy szyfr długości [size] o nieokreślonej zawartości, do
+        // wypełnienia przez data().
+        static cipher_t uninitialized(size_t size) {
+            cipher_t result;
+            result.allocate(size);
+            return result;
+        }
+
+        cipher_t(const cipher_t &other) : cipher_t(other.data(), other.size()) {}
+
+        cipher_t(cipher_t &&other) noexcept {
+            memcpy(storage, other.storage, object_size);
+            other.storage[inline_capacity] = char(inline_capacity);
+        }
+
+        cipher_t &operator=(cipher_t other) noexcept {
+            swap(storage, other.storage);
+            return *this;
+        }
+
+        ~cipher_t() {
+            release();
+        }
+
+        [[nodiscard]] const char *data() const noexcept {
+            return is_inline() ? storage : heap_data();
+        }
+
+        [[nodiscard]] char *data() noexcept {
+            return is_inline() ? storage : heap_data();
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return is_inline() ? inline_capacity - uint8_t(storage[inline_capacity])
+                               : heap_size();
+        }
+
+        [[nodiscard]] string_view view() const noexcept {
+            return {data(), size()};
+        }
+
+        bool operator==(const cipher_t &other) const noexcept {
+            return view() == other.view();
+        }
+    };
+
+    static_assert(sizeof(cipher_t) == 24);
+
+    // Hasz szyfru, zgodny z std::hash<std::string> dla tych samych bajtów.
+    struct cipher_hash_t {
+        size_t operator()(const cipher_t &cipher) const noexcept {
+            return hash<string_view>{}(cipher.view());
+        }
+    };
+
+    // Wolne bloki rozmiaru Size dla node_allocator_t, pobierane z systemu
+    // paczkami po chunk_blocks. Pamięć nie jest zwracana systemowi.
+    template<size_t Size>
+    class node_free_list_t {
+    private:
+        static constexpr size_t chunk_blocks = 64;
+        static constexpr size_t block_size =
+                (max(Size, sizeof(void *)) + alignof(max_align_t) - 1) /
+                alignof(max_align_t) * alignof(max_align_t);
+
+        void *head = nullptr;
+
+    public:
+        void *pop() {
+            if (head == nullptr) {
+                char *chunk = static_cast<char *>(
+                        ::operator new(block_size * chunk_blocks));
+                for (size_t i = 0; i < chunk_blocks; i++)
+                    push(chunk + i * block_size);
+            }
+
+            void *block = head;
+            memcpy(&head, block, sizeof(head));
+            return block;
+        }
+
+        void push(void *block) noexcept {
+            memcpy(block, &head, sizeof(head));
+            head = block;
+        }
+    };
+
+    template<size_t Size>
+    node_free_list_t<Size> &node_free_list() {
+        static auto *result = new node_free_list_t<Size>();
         return *result;
     }
 
-    unsigned long &next_new_id() {
-        static auto *result = new unsigned long();
+    // Alokator węzłów zbiorów szyfrów. Pojedyncze węzły pochodzą z listy
+    // wolnych bloków, więc wstawienie szyfru mieszczącego się w cipher_t
+    // zwykle nie alokuje pamięci. Tablice kubełków są alokowane zwyczajnie.
+    template<typename T>
+    struct node_allocator_t {
+        using value_type = T;
+
+        node_allocator_t() = default;
+
+        template<typename U>
+        node_allocator_t(const node_allocator_t<U> &) noexcept {}
+
+        T *allocate(size_t n) {
+            static_assert(alignof(T) <= alignof(max_align_t));
+            if (n == 1)
+                return static_cast<T *>(node_free_list<sizeof(T)>().pop());
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T *pointer, size_t n) noexcept {
+            if (n == 1)
+                node_free_list<sizeof(T)>().push(pointer);
+            else
+                ::operator delete(pointer);
+        }
+
+        template<typename U>
+        bool operator==(const node_allocator_t<U> &) const noexcept {
+            return true;
+        }
+
+        template<typename U>
+        bool operator!=(const node_allocator_t<U> &) const noexcept {
+            return false;
+        }
+    };
+
+    using encrypted_string_t = cipher_t;
+    using encrypted_set_t = unordered_set<encrypted_string_t, cipher_hash_t,
+            equal_to<>, node_allocator_t<encrypted_string_t>>;
+
+    // Format pliku zapisywanego przez encstrset_save (w natywnej kolejności
+    // bajtów): nagłówek, tablica bucket_count kubełków adresowanych liniowo
+    // haszem FNV-1a szyfru, a następnie rekordy [uint32_t długość][bajty].
+    // Kubełek zawiera przesunięcie rekordu w obszarze danych powiększone
+    // o 1, a 0 oznacza pusty kubełek.
+    struct file_header_t {
+        char magic[8];
+        uint64_t count;
+        uint64_t bucket_count;
+        uint64_t data_size;
+    };
+
+    const char file_magic[8] = {'E', 'N', 'C', 'S', 'T', 'R', 'S', '1'};
+
+    uint64_t stable_hash(const char *data, size_t length) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < length; i++) {
+            hash ^= uint8_t(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Zbiór wczytany z pliku, odpowiadający na zapytania bezpośrednio
+    // z odwzorowanej w pamięć zawartości pliku.
+    class mapped_set_t {
+    private:
+        void *address;
+        size_t length;
+        const file_header_t *header;
+        const uint64_t *buckets;
+        const char *data;
+
+        mapped_set_t(void *address, size_t length)
+                : address(address), length(length),
+                  header(static_cast<const file_header_t *>(address)),
+                  buckets(reinterpret_cast<const uint64_t *>(header + 1)),
+                  data(reinterpret_cast<const char *>(buckets +
+                                                      header->bucket_count)) {}
+
+        // Zwraca rekord kubełka [bucket] jako (wskaźnik, długość) albo
+        // (nullptr, 0), jeśli kubełek jest pusty lub uszkodzony.
+        pair<const char *, size_t> record(uint64_t bucket) const {
+            if (bucket == 0 || bucket - 1 > header->data_size - sizeof(uint32_t))
+                return {nullptr, 0};
+
+            uint32_t record_length;
+            memcpy(&record_length, data + bucket - 1, sizeof(uint32_t));
+            uint64_t begin = bucket - 1 + sizeof(uint32_t);
+            if (record_length > header->data_size - begin)
+                return {nullptr, 0};
+
+            return {data + begin, record_length};
+        }
+
+    public:
+        mapped_set_t(const mapped_set_t &) = delete;
+
+        mapped_set_t &operator=(const mapped_set_t &) = delete;
+
+        ~mapped_set_t() {
+            munmap(address, length);
+        }
+
+        // Odwzorowuje w pamięć plik [path] i sprawdza poprawność nagłówka.
+        // Zwraca nullptr, jeśli się to nie uda.
+        static shared_ptr<mapped_set_t> open(const char *path) {
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0)
+                return nullptr;
+
+            struct stat file_stat{};
+            if (fstat(fd, &file_stat) != 0 ||
+                size_t(file_stat.st_size) < sizeof(file_header_t)) {
+                close(fd);
+                return nullptr;
+            }
+
+            size_t length = file_stat.st_size;
+            void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (address == MAP_FAILED)
+                return nullptr;
+
+            auto header = static_cast<const file_header_t *>(address);
+            uint64_t max_buckets = (length - sizeof(file_header_t)) /
+                                   sizeof(uint64_t);
+            bool valid = memcmp(header->magic, file_magic, sizeof(file_magic)) == 0 &&
+                         header->bucket_count > header->count &&
+                         (header->bucket_count & (header->bucket_count - 1)) == 0 &&
+                         header->bucket_count <= max_buckets &&
+                         header->data_size >= sizeof(uint32_t) &&
+                         header->data_size == length - sizeof(file_header_t) -
+                                              header->bucket_count * sizeof(uint64_t);
+            if (!valid) {
+                munmap(address, length);
+                return nullptr;
+            }
+
+            return shared_ptr<mapped_set_t>(new mapped_set_t(address, length));
+        }
+
+        [[nodiscard]] size_t size() const {
+            return header->count;
+        }
+
+        [[nodiscard]] bool contains(const encrypted_string_t &cipher) const {
+            uint64_t mask = header->bucket_count - 1;
+            uint64_t index = stable_hash(cipher.data(), cipher.size()) & mask;
+
+            for (uint64_t probes = 0; probes <= mask; probes++) {
+                auto[record_data, record_length] = record(buckets[index]);
+                if (record_data == nullptr)
+                    return false;
+                if (record_length == cipher.size() &&
+                    memcmp(record_data, cipher.data(), record_length) == 0)
+                    return true;
+                index = (index + 1) & mask;
+            }
+
+            return false;
+        }
+
+        // Znajduje pierwszy niepusty kubełek o numerze co najmniej [bucket]
+        // i zwraca jego rekord, ustawiając [bucket] na następny kubełek.
+        // Zwraca (nullptr, 0), jeśli takiego kubełka nie ma.
+        pair<const char *, size_t> next_record(uint64_t &bucket) const {
+            while (bucket < header->bucket_count) {
+                auto result = record(buckets[bucket++]);
+                if (result.first != nullptr)
+                    return result;
+            }
+            return {nullptr, 0};
+        }
+
+        // Wywołuje [f] dla każdego szyfru zapisanego w pliku.
+        template<typename F>
+        void for_each(F f) const {
+            uint64_t bucket = 0;
+            for (auto[record_data, record_length] = next_record(bucket);
+                 record_data != nullptr;
+                 tie(record_data, record_length) = next_record(bucket))
+                f(encrypted_string_t(record_data, record_length));
+        }
+    };
+
+    // Blokowy filtr Blooma. Wszystkie bity elementu leżą w jednym 512-bitowym
+    // bloku, więc odpowiedź negatywna kosztuje odczyt jednej linii cache.
+    class bloom_filter_t {
+    private:
+        struct alignas(64) block_t {
+            uint64_t words[8];
+        };
+
+        static constexpr size_t bits_per_element = 10;
+        static constexpr size_t min_capacity = 64;
+        // Liczba bitów ustawianych na element; 7 pozycji po 9 bitów mieści się
+        // w jednym 64-bitowym haszu.
+        static constexpr int hash_count = 7;
+
+        vector<block_t> blocks;
+        size_t capacity;
+        size_t added = 0;
+        size_t removed = 0;
+
+        // Miesza hasz, żeby pozycje bitów w bloku nie zależały od bitów
+        // użytych do wyboru bloku.
+        static uint64_t mix(uint64_t hash) {
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdull;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        // Wybiera blok bez dzielenia modulo (mnożenie i przesunięcie).
+        // Iloczyn mieści się w 64 bitach, dopóki bloków jest mniej niż 2^32.
+        size_t block_index(uint64_t hash) const {
+            return size_t((hash >> 32) * uint64_t(blocks.size()) >> 32);
+        }
+
+    public:
+        // Tworzy pusty filtr dobrany dla [expected] elementów.
+        explicit bloom_filter_t(size_t expected)
+                : capacity(max(expected, min_capacity)) {
+            size_t bits = capacity * bits_per_element;
+            blocks.assign((bits + 511) / 512, block_t{});
+        }
+
+        void add(uint64_t hash) {
+            block_t &target = blocks[block_index(hash)];
+            uint64_t bits = mix(hash);
+            for (int i = 0; i < hash_count; i++, bits >>= 9)
+                target.words[(bits >> 6) & 7] |= uint64_t(1) << (bits & 63);
+            added++;
+        }
+
+        [[nodiscard]] bool may_contain(uint64_t hash) const {
+            const block_t &target = blocks[block_index(hash)];
+            uint64_t bits = mix(hash);
+            for (int i = 0; i < hash_count; i++, bits >>= 9) {
+                if (!(target.words[(bits >> 6) & 7] & (uint64_t(1) << (bits & 63))))
+                    return false;
+            }
+            return true;
+        }
+
+        void note_removal() {
+            removed++;
+        }
+
+        // Filtr wymaga przebudowy, gdy przekroczono liczbę elementów, dla
+        // której go dobrano, albo gdy zbyt wiele jego bitów pochodzi od
+        // usuniętych elementów.
+        [[nodiscard]] bool needs_rebuild() const {
+            return added > capacity || removed * 4 > added;
+        }
+    };
+
+    uint64_t cipher_hash(const encrypted_string_t &cipher) {
+        return cipher_hash_t{}(cipher);
+    }
+
+    // Liczniki zapytań encstrset_test dla zbioru z filtrem Blooma.
+    struct bloom_stats_t {
+        size_t queries;
+        size_t rejected;
+        size_t false_positives;
+    };
+
+    // Zbiór widziany przez API. Zawartość jest współdzielona między zbiorem
+    // a jego migawkami i kopiowana dopiero przy pierwszej modyfikacji
+    // (copy-on-write). Zbiór wczytany z pliku trzyma zamiast niej
+    // odwzorowanie pliku w [mapped], aż do pierwszej modyfikacji.
+    struct set_entry_t {
+        shared_ptr<encrypted_set_t> ciphers;
+        bool read_only;
+        shared_ptr<const mapped_set_t> mapped = nullptr;
+        // Opcjonalny filtr Blooma, współdzielony na tej samej zasadzie co
+        // zawartość.
+        shared_ptr<bloom_filter_t> bloom = nullptr;
+        bloom_stats_t bloom_stats = {};
+    };
+
+    // Rejestr zbiorów indeksowany identyfikatorami. Identyfikator składa się
+    // z numeru slotu (młodsza połowa bitów) i generacji slotu (starsza
+    // połowa). Usunięcie zbioru zwalnia slot do ponownego użycia i zwiększa
+    // jego generację, więc identyfikatory usuniętych zbiorów pozostają
+    // nieważne. Wyszukanie zbioru to sprawdzenie zakresu i generacji.
+    class set_registry_t {
+    private:
+        struct slot_t {
+            unsigned long generation;
+            optional<set_entry_t> entry;
+        };
+
+        static constexpr int slot_bits = numeric_limits<unsigned long>::digits / 2;
+        static constexpr unsigned long slot_mask = (1ul << slot_bits) - 1;
+
+        vector<slot_t> slots;
+        vector<unsigned long> free_slots;
+
+    public:
+        // Umieszcza [entry] w wolnym slocie i zwraca identyfikator zbioru.
+        unsigned long add(set_entry_t entry) {
+            unsigned long slot;
+            if (free_slots.empty()) {
+                slot = slots.size();
+                slots.push_back(slot_t{0, nullopt});
+            } else {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            }
+
+            slots[slot].entry = move(entry);
+            return slots[slot].generation << slot_bits | slot;
+        }
+
+        // Zwraca wskaźnik na zbiór o identyfikatorze [id] albo nullptr.
+        set_entry_t *find(unsigned long id) {
+            unsigned long slot = id & slot_mask;
+            if (slot >= slots.size() ||
+                slots[slot].generation != id >> slot_bits ||
+                !slots[slot].entry.has_value())
+                return nullptr;
+
+            return &*slots[slot].entry;
+        }
+
+        // Usuwa zbiór o identyfikatorze [id]. Zwraca false, jeśli nie
+        // istniał.
+        bool erase(unsigned long id) {
+            if (find(id) == nullptr)
+                return false;
+
+            slot_t &slot = slots[id & slot_mask];
+            slot.entry = nullopt;
+            // Slot z wyczerpaną generacją nie jest już używany, żeby nie
+            // wydać ponownie żadnego identyfikatora.
+            if (++slot.generation < slot_mask)
+                free_slots.push_back(id & slot_mask);
+
+            return true;
+        }
+    };
+
+    // Zmienne globalne.
+
+    set_registry_t &encrypted_sets() {
+        static auto *result = new set_registry_t();
         return *result;
     }
 
     // Funkcje pomocnicze.
 
-    // Zwraca std::string "NULL", jeśli [c_string] jest nullem,
-    // w przeciwnym przypadku zwraca [c_string] jako std::string otoczony
+    // Tekst zapisany w zdarzeniu diagnostycznym: fragment argumentu, szyfru
+    // lub ścieżki. Pole data równe nullptr oznacza NULL, a truncated to, że
+    // zapisano tylko początek tekstu.
+    struct trace_text_t {
+        const char *data;
+        size_t size;
+        bool truncated;
+    };
+
+    trace_text_t make_trace_text(const char *c_string) {
+        return {c_string, c_string == nullptr ? 0 : strlen(c_string), false};
+    }
+
+    trace_text_t make_trace_text(const encrypted_string_t &cipher) {
+        return {cipher.data(), cipher.size(), false};
+    }
+
+    // Zwraca std::string "NULL", jeśli [text] jest nullem,
+    // w przeciwnym przypadku zwraca [text] jako std::string otoczony
     // cudzysłowami.
-    string get_quoted_string(const char *c_string) {
-        if (c_string == nullptr)
+    string get_quoted_string(const trace_text_t &text) {
+        if (text.data == nullptr)
             return "NULL";
         else
-            return "\"" + string(c_string) + "\"";
+            return "\"" + string(text.data, text.size) +
+                   (text.truncated ? "..." : "") + "\"";
     }
 
-    // Zwraca string w postaci ciągu charów z encrypted_string zapisanych jako
+    // Zwraca string w postaci ciągu charów z [text] zapisanych jako
     // liczby w systemie szesnastkowym oddzielone spacją.
     // Ciąg jest otoczony cudzysłowami.
 
-    string get_hex_str(const encrypted_string_t &encrypted_str) {
+    string get_hex_str(const trace_text_t &text) {
         stringstream s_stream;
 
         s_stream << "\"";
@@ -61,7 +578,7 @@ namespace {
 
         bool first_char = true;
 
-        for (char c: encrypted_str) {
+        for (char c: string_view(text.data, text.size)) {
             if (first_char)
                 first_char = false;
             else
@@ -75,11 +592,324 @@ namespace {
 
         }
 
+        if (text.truncated)
+            s_stream << " ...";
+
         s_stream << "\"";
 
         return s_stream.str();
     }
 
+    // Diagnostyka.
+    //
+    // Każda linia diagnostyki jest zapisywana jako binarne zdarzenie
+    // w buforze cyklicznym trace_ring(). W trybie echo (domyślnym) zdarzenie
+    // jest od razu wypisywane na cerr, a encstrset_trace_dump() wypisuje
+    // zawartość bufora w tym samym formacie. Bez echa zapis zdarzenia to
+    // kilka przypisań i kopii krótkich tekstów.
+
+    // Funkcja API, której dotyczy zdarzenie.
+    enum class trace_op_t : uint8_t {
+        new_set, delete_set, size, insert, remove, test, clear, copy,
+        snapshot, save, load, set_bloom, bloom_stats, cursor_open,
+        cursor_close, export_set
+    };
+
+    const char *const trace_op_names[] = {
+            "encstrset_new", "encstrset_delete", "encstrset_size",
+            "encstrset_insert", "encstrset_remove", "encstrset_test",
+            "encstrset_clear", "encstrset_copy", "encstrset_snapshot",
+            "encstrset_save", "encstrset_load", "encstrset_set_bloom",
+            "encstrset_bloom_stats", "encstrset_cursor_open",
+            "encstrset_cursor_close", "encstrset_export"
+    };
+
+    // Rodzaj zdarzenia: wywołanie funkcji albo jeden z jej wyników.
+    enum class trace_result_t : uint8_t {
+        call, created, deleted, does_not_exist, contains, invalid_value,
+        inserted, already_present, removed, not_removed, present, not_present,
+        cleared, read_only, copy_already_present, copied, snapshot_created,
+        invalid_path, saved, save_failed, loaded, invalid_file,
+        bloom_enabled, bloom_disabled, no_bloom, bloom_stats, cursor_opened,
+        export_needs, exported
+    };
+
+    // Zdarzenie diagnostyczne. Znaczenie pól zależy od rodzaju zdarzenia:
+    // numbers[0] to drugi identyfikator zbioru lub liczba z komunikatu,
+    // numbers[1..2] to pozostałe liczby statystyk filtra Blooma, a dla
+    // zdarzeń z szyfrem numbers[2] to jego hasz. W texts zapisywane są
+    // początki argumentów value i key wywołania albo szyfru lub ścieżki.
+    struct alignas(64) trace_event_t {
+        static constexpr size_t text_capacity = 40;
+        static constexpr uint32_t null_text = numeric_limits<uint32_t>::max();
+
+        uint64_t id;
+        uint64_t numbers[3];
+        uint32_t text_sizes[2];
+        trace_op_t op;
+        trace_result_t result;
+        char texts[2][text_capacity];
+
+        void set_text(size_t index, const trace_text_t &text) {
+            if (text.data == nullptr) {
+                text_sizes[index] = null_text;
+            } else {
+                text_sizes[index] = uint32_t(text.size);
+                memcpy(texts[index], text.data, min(text.size, text_capacity));
+            }
+        }
+
+        [[nodiscard]] trace_text_t get_text(size_t index) const {
+            if (text_sizes[index] == null_text)
+                return {nullptr, 0, false};
+            return {texts[index], min<size_t>(text_sizes[index], text_capacity),
+                    text_sizes[index] > text_capacity};
+        }
+    };
+
+    static_assert(sizeof(trace_event_t) == 128);
+
+    class trace_ring_t {
+    private:
+        static constexpr size_t capacity = 4096;
+
+        vector<trace_event_t> events = vector<trace_event_t>(capacity);
+        uint64_t next = 0;
+
+    public:
+        bool echo = true;
+
+        trace_event_t &push() {
+            return events[next++ & (capacity - 1)];
+        }
+
+        // Wywołuje [f] dla zdarzeń z bufora, od najstarszego.
+        template<typename F>
+        void for_each(F f) const {
+            uint64_t first = next > capacity ? next - capacity : 0;
+            for (uint64_t i = first; i < next; i++)
+                f(events[i & (capacity - 1)]);
+        }
+    };
+
+    trace_ring_t &trace_ring() {
+        static auto *result = new trace_ring_t();
+        return *result;
+    }
+
+    // Wypisuje zdarzenie [event] jako linię dzisiejszego formatu tekstowego.
+    // Teksty są brane z [texts], co pozwala w trybie echo wypisać je w całości.
+    void print_event(ostream &out, const trace_event_t &event,
+                     const trace_text_t texts[2]) {
+        uint64_t id = event.id;
+        uint64_t number = event.numbers[0];
+
+        out << trace_op_names[size_t(event.op)];
+
+        if (event.result == trace_result_t::call) {
+            switch (event.op) {
+                case trace_op_t::new_set:
+                case trace_op_t::cursor_close:
+                    out << "()";
+                    break;
+                case trace_op_t::insert:
+                case trace_op_t::remove:
+                case trace_op_t::test:
+                    out << "(" << id << ", " << get_quoted_string(texts[0])
+                        << ", " << get_quoted_string(texts[1]) << ")";
+                    break;
+                case trace_op_t::copy:
+                case trace_op_t::export_set:
+                    out << "(" << id << ", " << number << ")";
+                    break;
+                case trace_op_t::save:
+                    out << "(" << id << ", " << get_quoted_string(texts[0])
+                        << ")";
+                    break;
+                case trace_op_t::load:
+                    out << "(" << get_quoted_string(texts[0]) << ")";
+                    break;
+                case trace_op_t::set_bloom:
+                    out << "(" << id << ", " << (number ? "true" : "false")
+                        << ")";
+                    break;
+                default:
+                    out << "(" << id << ")";
+                    break;
+            }
+            out << '\n';
+            return;
+        }
+
+        out << ": ";
+
+        switch (event.result) {
+            case trace_result_t::created:
+                out << "set #" << id << " created";
+                break;
+            case trace_result_t::deleted:
+                out << "set #" << id << " deleted";
+                break;
+            case trace_result_t::does_not_exist:
+                out << "set #" << id << " does not exist";
+                break;
+            case trace_result_t::contains:
+                out << "set #" << id << " contains " << number
+                    << " element(s)";
+                break;
+            case trace_result_t::invalid_value:
+                out << "invalid value (NULL)";
+                break;
+            case trace_result_t::inserted:
+                out << "set #" << id << ", cypher " << get_hex_str(texts[0])
+                    << " inserted";
+                break;
+            case trace_result_t::already_present:
+                out << "set #" << id << ", cypher " << get_hex_str(texts[0])
+                    << " was already present";
+                break;
+            case trace_result_t::removed:
+                out << "set #" << id << ", cypher " << get_hex_str(texts[0])
+                    << " removed";
+                break;
+            case trace_result_t::not_removed:
+                out << "set #" << id << ", cypher " << get_hex_str(texts[0])
+                    << " was not present";
+                break;
+            case trace_result_t::present:
+                out << "set #" << id << ", cypher " << get_hex_str(texts[0])
+                    << " is present";
+                break;
+            case trace_result_t::not_present:
+                out << "set #" << id << ", cypher " << get_hex_str(texts[0])
+                    << " is not present";
+                break;
+            case trace_result_t::cleared:
+                out << "set #" << id << " cleared";
+                break;
+            case trace_result_t::read_only:
+                out << "set #" << id << " is read-only";
+                break;
+            case trace_result_t::copy_already_present:
+                out << "copied cypher " << get_hex_str(texts[0])
+                    << " was already present in set #" << number;
+                break;
+            case trace_result_t::copied:
+                out << "cypher " << get_hex_str(texts[0]) << " copied from set #"
+                    << id << " to set #" << number;
+                break;
+            case trace_result_t::snapshot_created:
+                out << "set #" << id << " created as a snapshot of set #"
+                    << number;
+                break;
+            case trace_result_t::invalid_path:
+                out << "invalid path (NULL)";
+                break;
+            case trace_result_t::saved:
+                out << "set #" << id << " saved to "
+                    << get_quoted_string(texts[0]);
+                break;
+            case trace_result_t::save_failed:
+                out << "set #" << id << " could not be saved to "
+                    << get_quoted_string(texts[0]);
+                break;
+            case trace_result_t::loaded:
+                out << "set #" << id << " loaded from "
+                    << get_quoted_string(texts[0]);
+                break;
+            case trace_result_t::invalid_file:
+                out << get_quoted_string(texts[0]) << " is not a valid set file";
+                break;
+            case trace_result_t::bloom_enabled:
+                out << "set #" << id << ", bloom filter enabled";
+                break;
+            case trace_result_t::bloom_disabled:
+                out << "set #" << id << ", bloom filter disabled";
+                break;
+            case trace_result_t::no_bloom:
+                out << "set #" << id << " has no bloom filter";
+                break;
+            case trace_result_t::bloom_stats: {
+                uint64_t absent = event.numbers[1] + event.numbers[2];
+                double rate = absent == 0 ? 0.0
+                                          : double(event.numbers[2]) /
+                                            double(absent);
+                out << "set #" << id << ", " << event.numbers[0]
+                    << " quer(ies), " << event.numbers[1]
+                    << " rejected by bloom filter, " << event.numbers[2]
+                    << " false positive(s), false positive rate " << rate;
+                break;
+            }
+            case trace_result_t::cursor_opened:
+                out << "set #" << id << ", cursor opened";
+                break;
+            case trace_result_t::export_needs:
+                out << "set #" << id << ", export needs " << number
+                    << " byte(s)";
+                break;
+            case trace_result_t::exported:
+                out << "set #" << id << ", " << number << " cypher(s) exported";
+                break;
+            case trace_result_t::call:
+                break;
+        }
+
+        out << '\n';
+    }
+
+    // Zapisuje zdarzenie w buforze i w trybie echo wypisuje je na cerr.
+    void trace(trace_op_t op, trace_result_t result, uint64_t id,
+               uint64_t number0, uint64_t number1, uint64_t number2,
+               const trace_text_t &text0, const trace_text_t &text1) {
+        trace_event_t &event = trace_ring().push();
+        event.id = id;
+        event.numbers[0] = number0;
+        event.numbers[1] = number1;
+        event.numbers[2] = number2;
+        event.op = op;
+        event.result = result;
+        event.set_text(0, text0);
+        event.set_text(1, text1);
+
+        if (trace_ring().echo) {
+            const trace_text_t texts[2] = {text0, text1};
+            print_event(cerr, event, texts);
+        }
+    }
+
+    const trace_text_t no_text = {nullptr, 0, false};
+
+    // Rejestruje wywołanie funkcji [op]. Argumenty niewystępujące w jej
+    // sygnaturze są pomijane przy wypisywaniu.
+    void trace_call(trace_op_t op, uint64_t id = 0, uint64_t number = 0,
+                    const char *value = nullptr, const char *key = nullptr) {
+        if (debug_enabled)
+            trace(op, trace_result_t::call, id, number, 0, 0,
+                  make_trace_text(value), make_trace_text(key));
+    }
+
+    // Rejestruje wynik [result] funkcji [op].
+    void trace_result(trace_op_t op, trace_result_t result, uint64_t id = 0,
+                      uint64_t number = 0) {
+        if (debug_enabled)
+            trace(op, result, id, number, 0, 0, no_text, no_text);
+    }
+
+    // Rejestruje wynik [result] funkcji [op] dotyczący szyfru [cipher].
+    void trace_result(trace_op_t op, trace_result_t result, uint64_t id,
+                      uint64_t number, const encrypted_string_t &cipher) {
+        if (debug_enabled)
+            trace(op, result, id, number, 0, cipher_hash_t{}(cipher),
+                  make_trace_text(cipher), no_text);
+    }
+
+    // Rejestruje wynik [result] funkcji [op] dotyczący pliku [path].
+    void trace_result(trace_op_t op, trace_result_t result, uint64_t id,
+                      const char *path) {
+        if (debug_enabled)
+            trace(op, result, id, 0, 0, 0, make_trace_text(path), no_text);
+    }
+
     // Szyfruje ciąg znaków value kluczem key za pomocą operacji bitowej XOR.
     // Zwraca zaszyfrowany ciąg znaków.
     // Wartość value musi być różna od nullptr.
@@ -89,208 +919,666 @@ namespace {
             exit(EXIT_FAILURE);
         }
 
+        size_t value_len = strlen(value);
+        encrypted_string_t result = encrypted_string_t::uninitialized(value_len);
+        char *result_data = result.data();
+
         if (key == nullptr || strlen(key) == 0) {
-            return string(value);
+            memcpy(result_data, value, value_len);
+            return result;
         }
 
-        stringstream result;
-
         size_t key_len = strlen(key);
         size_t key_index = 0;
 
-        for (; *value != '\0'; value++) {
-            result << char(*value ^ key[key_index]);
-            key_index = (key_index + 1) % key_len;
+        for (size_t i = 0; i < value_len; i++) {
+            result_data[i] = char(value[i] ^ key[key_index]);
+            if (++key_index == key_len)
+                key_index = 0;
         }
 
-        return result.str();
+        return result;
     }
 
     // Jeśli istnieje zbiór o podanym [id] to zwraca referencję do niego
     // owiniętą w optional'a. W przeciwnym wypadku zwraca pustego optional'a.
-    optional<reference_wrapper<encrypted_set_t>> get_by_id(unsigned long id) {
-        auto iterator = encrypted_sets().find(id);
+    optional<reference_wrapper<set_entry_t>> get_by_id(unsigned long id) {
+        set_entry_t *entry = encrypted_sets().find(id);
 
-        if (iterator != encrypted_sets().end())
-            return iterator->second;
+        if (entry != nullptr)
+            return *entry;
         else
             return nullopt;
     }
+
+    size_t get_size(const set_entry_t &entry) {
+        return entry.mapped ? entry.mapped->size() : entry.ciphers->size();
+    }
+
+    bool contains(const set_entry_t &entry, const encrypted_string_t &cipher) {
+        return entry.mapped ? entry.mapped->contains(cipher)
+                            : entry.ciphers->count(cipher) != 0;
+    }
+
+    // Wywołuje [f] dla każdego szyfru ze zbioru [entry].
+    template<typename F>
+    void for_each_cipher(const set_entry_t &entry, F f) {
+        if (entry.mapped) {
+            entry.mapped->for_each(f);
+        } else {
+            for (const encrypted_string_t &cipher : *entry.ciphers)
+                f(cipher);
+        }
+    }
+
+    // Zwraca zawartość zbioru [entry] do modyfikacji. Jeśli zawartość jest
+    // współdzielona z migawką, najpierw tworzy jej prywatną kopię, a jeśli
+    // pochodzi z pliku, kopiuje ją do pamięci procesu.
+    encrypted_set_t &get_writable(set_entry_t &entry) {
+        if (entry.mapped) {
+            auto ciphers = make_shared<encrypted_set_t>();
+            ciphers->reserve(entry.mapped->size());
+            entry.mapped->for_each([&](encrypted_string_t cipher) {
+                ciphers->emplace(move(cipher));
+            });
+            entry.ciphers = move(ciphers);
+            entry.mapped = nullptr;
+        } else if (entry.ciphers.use_count() > 1) {
+            entry.ciphers = make_shared<encrypted_set_t>(*entry.ciphers);
+        }
+
+        return *entry.ciphers;
+    }
+
+    // Buduje od nowa filtr Blooma zbioru [entry] na podstawie jego zawartości.
+    void rebuild_bloom(set_entry_t &entry) {
+        auto bloom = make_shared<bloom_filter_t>(2 * get_size(entry));
+        for_each_cipher(entry, [&](const encrypted_string_t &cipher) {
+            bloom->add(cipher_hash(cipher));
+        });
+        entry.bloom = move(bloom);
+    }
+
+    // Zwraca filtr Blooma zbioru [entry] do modyfikacji, kopiując go, jeśli
+    // jest współdzielony.
+    bloom_filter_t &get_writable_bloom(set_entry_t &entry) {
+        if (entry.bloom.use_count() > 1)
+            entry.bloom = make_shared<bloom_filter_t>(*entry.bloom);
+
+        return *entry.bloom;
+    }
+
+    // Uaktualnia filtr Blooma po dodaniu [cipher] do zbioru [entry].
+    void bloom_inserted(set_entry_t &entry, const encrypted_string_t &cipher) {
+        if (!entry.bloom)
+            return;
+
+        bloom_filter_t &bloom = get_writable_bloom(entry);
+        bloom.add(cipher_hash(cipher));
+        if (bloom.needs_rebuild())
+            rebuild_bloom(entry);
+    }
+
+    // Uaktualnia filtr Blooma po usunięciu elementu ze zbioru [entry].
+    // Bity usuniętego elementu zostają w filtrze (co jest poprawne, choć
+    // zwiększa liczbę fałszywych trafień) do czasu przebudowy filtra.
+    void bloom_removed(set_entry_t &entry) {
+        if (!entry.bloom)
+            return;
+
+        bloom_filter_t &bloom = get_writable_bloom(entry);
+        bloom.note_removal();
+        if (bloom.needs_rebuild())
+            rebuild_bloom(entry);
+    }
+
+    // Sprawdza, czy [cipher] należy do zbioru [entry], odpytując najpierw
+    // jego filtr Blooma, o ile jest włączony.
+    bool bloom_test(set_entry_t &entry, const encrypted_string_t &cipher) {
+        if (!entry.bloom)
+            return contains(entry, cipher);
+
+        entry.bloom_stats.queries++;
+        if (!entry.bloom->may_contain(cipher_hash(cipher))) {
+            entry.bloom_stats.rejected++;
+            return false;
+        }
+
+        bool result = contains(entry, cipher);
+        if (!result)
+            entry.bloom_stats.false_positives++;
+        return result;
+    }
+
+    // Zapisuje [length] bajtów spod [data] do deskryptora [fd].
+    bool write_all(int fd, const void *data, size_t length) {
+        auto bytes = static_cast<const char *>(data);
+        while (length > 0) {
+            ssize_t written = write(fd, bytes, length);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            bytes += written;
+            length -= size_t(written);
+        }
+        return true;
+    }
+
+    // Zapisuje zawartość zbioru [entry] do pliku [path] w formacie
+    // opisanym przy file_header_t. Zwraca false w razie błędu zapisu.
+    bool save_to_file(const set_entry_t &entry, const char *path) {
+        uint64_t count = get_size(entry);
+        uint64_t bucket_count = 1;
+        while (bucket_count < 2 * count + 1)
+            bucket_count *= 2;
+
+        vector<uint64_t> buckets(bucket_count, 0);
+        // Obszar danych zaczyna się od pustego rekordu, dzięki czemu nawet
+        // pusty zbiór ma poprawny, niepusty obszar danych.
+        string data(sizeof(uint32_t), '\0');
+
+        for_each_cipher(entry, [&](const encrypted_string_t &cipher) {
+            uint64_t mask = bucket_count - 1;
+            uint64_t index = stable_hash(cipher.data(), cipher.size()) & mask;
+            while (buckets[index] != 0)
+                index = (index + 1) & mask;
+            buckets[index] = data.size() + 1;
+
+            auto record_length = uint32_t(cipher.size());
+            data.append(reinterpret_cast<const char *>(&record_length),
+                        sizeof(record_length));
+            data.append(cipher.data(), cipher.size());
+        });
+
+        file_header_t header{};
+        memcpy(header.magic, file_magic, sizeof(file_magic));
+        header.count = count;
+        header.bucket_count = bucket_count;
+        header.data_size = data.size();
+
+        // Zbiory wczytane wcześniej z [path] mają ten plik odwzorowany
+        // w pamięci, więc nie wolno go nadpisać. Zapisujemy plik tymczasowy
+        // w tym samym katalogu i podmieniamy go przez rename(); stare
+        // odwzorowania zachowują poprzedni i-węzeł.
+        string temp_path = string(path) + ".XXXXXX";
+        int fd = mkstemp(temp_path.data());
+        if (fd < 0)
+            return false;
+
+        // mkstemp tworzy plik z prawami 0600; zachowujemy prawa
+        // nadpisywanego pliku.
+        struct stat target_stat{};
+        mode_t mode = stat(path, &target_stat) == 0 ? target_stat.st_mode & 07777
+                                                    : 0644;
+        bool written = fchmod(fd, mode) == 0 &&
+                       write_all(fd, &header, sizeof(header)) &&
+                       write_all(fd, buckets.data(),
+                                 bucket_count * sizeof(uint64_t)) &&
+                       write_all(fd, data.data(), data.size()) &&
+                       fsync(fd) == 0;
+        if (close(fd) != 0)
+            written = false;
+
+        if (!written || rename(temp_path.c_str(), path) != 0) {
+            unlink(temp_path.c_str());
+            return false;
+        }
+        return true;
+    }
 }
 
 namespace jnp1 {
 
     unsigned long encstrset_new() {
-        debug_stream << "()" << endl;
-        encrypted_sets().emplace(next_new_id(), encrypted_set_t{});
-        debug_stream << ": set #" << next_new_id() << " created" << endl;
-        return next_new_id()++;
+        trace_call(trace_op_t::new_set);
+        unsigned long id = encrypted_sets().add(set_entry_t{
+                make_shared<encrypted_set_t>(), false});
+        trace_result(trace_op_t::new_set, trace_result_t::created, id);
+        return id;
     }
 
     void encstrset_delete(unsigned long id) {
-        debug_stream << "(" << id << ")" << endl;
-        if (encrypted_sets().erase(id) != 0) {
-            debug_stream << ": set #" << id << " deleted" << endl;
+        trace_call(trace_op_t::delete_set, id);
+        if (encrypted_sets().erase(id)) {
+            trace_result(trace_op_t::delete_set, trace_result_t::deleted, id);
         } else {
-            debug_stream << ": set #" << id << " does not exist" << endl;
+            trace_result(trace_op_t::delete_set, trace_result_t::does_not_exist,
+                         id);
         }
     }
 
     size_t encstrset_size(unsigned long id) {
-        debug_stream << "(" << id << ")" << endl;
+        trace_call(trace_op_t::size, id);
         auto optional_encrypted_set = get_by_id(id);
 
         if (optional_encrypted_set.has_value()) {
-            size_t set_size = optional_encrypted_set->get().size();
-            debug_stream << ": set #" << id << " contains " << set_size
-                         << " element(s)" << endl;
+            size_t set_size = get_size(optional_encrypted_set->get());
+            trace_result(trace_op_t::size, trace_result_t::contains, id,
+                         set_size);
             return set_size;
         } else {
-            debug_stream << ": set #" << id << " does not exist" << endl;
+            trace_result(trace_op_t::size, trace_result_t::does_not_exist, id);
             return 0;
         }
     }
 
     bool
     encstrset_insert(unsigned long id, const char *value, const char *key) {
-        debug_stream << "(" << id << ", " << get_quoted_string(value) << ", "
-                     << get_quoted_string(key) << ")" << endl;
+        const trace_op_t op = trace_op_t::insert;
+        trace_call(op, id, 0, value, key);
 
         if (value == nullptr) {
-            debug_stream << ": invalid value (NULL)" << endl;
+            trace_result(op, trace_result_t::invalid_value);
             return false;
         }
 
         auto optional_encrypted_set = get_by_id(id);
 
-        if (optional_encrypted_set.has_value()) {
-            encrypted_set_t &encrypted_set = optional_encrypted_set->get();
+        if (optional_encrypted_set.has_value() &&
+            optional_encrypted_set->get().read_only) {
+            trace_result(op, trace_result_t::read_only, id);
+            return false;
+        } else if (optional_encrypted_set.has_value()) {
+            set_entry_t &entry = optional_encrypted_set->get();
             encrypted_string_t encrypted_string = encrypt(value, key);
 
-            if (encrypted_set.count(encrypted_string)) {
-                debug_stream << ": set #" << id << ", cypher "
-                             << get_hex_str(encrypted_string)
-                             << " was already present" << endl;
+            if (contains(entry, encrypted_string)) {
+                trace_result(op, trace_result_t::already_present, id, 0,
+                             encrypted_string);
                 return false;
             } else {
-                encrypted_set.emplace(encrypted_string);
-                debug_stream << ": set #" << id << ", cypher "
-                             << get_hex_str(encrypted_string) << " inserted"
-                             << endl;
+                const encrypted_string_t &inserted =
+                        *get_writable(entry).emplace(move(encrypted_string)).first;
+                bloom_inserted(entry, inserted);
+                trace_result(op, trace_result_t::inserted, id, 0, inserted);
                 return true;
             }
         } else {
-            debug_stream << ": set #" << id << " does not exist" << endl;
+            trace_result(op, trace_result_t::does_not_exist, id);
             return false;
         }
     }
 
     bool
     encstrset_remove(unsigned long id, const char *value, const char *key) {
-        debug_stream << "(" << id << ", " << get_quoted_string(value) << ", "
-                     << get_quoted_string(key) << ")" << endl;
+        const trace_op_t op = trace_op_t::remove;
+        trace_call(op, id, 0, value, key);
 
         if (value == nullptr) {
-            debug_stream << ": invalid value (NULL)" << endl;
+            trace_result(op, trace_result_t::invalid_value);
             return false;
         }
 
         auto optional_encrypted_set = get_by_id(id);
 
-        if (optional_encrypted_set.has_value()) {
-            encrypted_set_t &encrypted_set = optional_encrypted_set->get();
+        if (optional_encrypted_set.has_value() &&
+            optional_encrypted_set->get().read_only) {
+            trace_result(op, trace_result_t::read_only, id);
+            return false;
+        } else if (optional_encrypted_set.has_value()) {
+            set_entry_t &entry = optional_encrypted_set->get();
             encrypted_string_t encrypted_string = encrypt(value, key);
 
-            if (encrypted_set.count(encrypted_string)) {
-                encrypted_set.erase(encrypted_string);
-                debug_stream << ": set #" << id << ", cypher "
-                             << get_hex_str(encrypted_string) << " removed"
-                             << endl;
+            if (contains(entry, encrypted_string)) {
+                get_writable(entry).erase(encrypted_string);
+                bloom_removed(entry);
+                trace_result(op, trace_result_t::removed, id, 0,
+                             encrypted_string);
                 return true;
             } else {
-                debug_stream << ": set #" << id << ", cypher "
-                             << get_hex_str(encrypted_string)
-                             << " was not present" << endl;
+                trace_result(op, trace_result_t::not_removed, id, 0,
+                             encrypted_string);
                 return false;
             }
         } else {
-            debug_stream << ": set #" << id << " does not exist" << endl;
+            trace_result(op, trace_result_t::does_not_exist, id);
             return false;
         }
     }
 
     bool encstrset_test(unsigned long id, const char *value, const char *key) {
-        debug_stream << "(" << id << ", " << get_quoted_string(value) << ", "
-                     << get_quoted_string(key) << ")" << endl;
+        const trace_op_t op = trace_op_t::test;
+        trace_call(op, id, 0, value, key);
 
         if (value == nullptr) {
-            debug_stream << ": invalid value (NULL)" << endl;
+            trace_result(op, trace_result_t::invalid_value);
             return false;
         }
 
         auto optional_encrypted_set = get_by_id(id);
 
         if (optional_encrypted_set.has_value()) {
-            const encrypted_set_t &encrypted_set = optional_encrypted_set->get();
+            set_entry_t &entry = optional_encrypted_set->get();
             encrypted_string_t encrypted_string = encrypt(value, key);
 
-            if (encrypted_set.count(encrypted_string)) {
-                debug_stream << ": set #" << id << ", cypher "
-                             << get_hex_str(encrypted_string) << " is present"
-                             << endl;
+            if (bloom_test(entry, encrypted_string)) {
+                trace_result(op, trace_result_t::present, id, 0,
+                             encrypted_string);
                 return true;
             } else {
-                debug_stream << ": set #" << id << ", cypher "
-                             << get_hex_str(encrypted_string)
-                             << " is not present" << endl;
+                trace_result(op, trace_result_t::not_present, id, 0,
+                             encrypted_string);
                 return false;
             }
         } else {
-            debug_stream << ": set #" << id << " does not exist" << endl;
+            trace_result(op, trace_result_t::does_not_exist, id);
             return false;
         }
     }
 
     void encstrset_clear(unsigned long id) {
-        debug_stream << "(" << id << ")" << endl;
+        const trace_op_t op = trace_op_t::clear;
+        trace_call(op, id);
 
         auto optional_encrypted_set = get_by_id(id);
 
-        if (optional_encrypted_set.has_value()) {
-            encrypted_set_t &encrypted_set = optional_encrypted_set->get();
-            encrypted_set.clear();
-            debug_stream << ": set #" << id << " cleared" << endl;
+        if (optional_encrypted_set.has_value() &&
+            optional_encrypted_set->get().read_only) {
+            trace_result(op, trace_result_t::read_only, id);
+        } else if (optional_encrypted_set.has_value()) {
+            // Wyczyszczenie współdzielonej zawartości nie wymaga jej kopiowania.
+            set_entry_t &entry = optional_encrypted_set->get();
+            entry.ciphers = make_shared<encrypted_set_t>();
+            entry.mapped = nullptr;
+            if (entry.bloom)
+                entry.bloom = make_shared<bloom_filter_t>(0);
+            trace_result(op, trace_result_t::cleared, id);
         } else {
-            debug_stream << ": set #" << id << " does not exist" << endl;
+            trace_result(op, trace_result_t::does_not_exist, id);
         }
     }
 
     void encstrset_copy(unsigned long src_id, unsigned long dst_id) {
-        debug_stream << "(" << src_id << ", " << dst_id << ")" << endl;
+        const trace_op_t op = trace_op_t::copy;
+        trace_call(op, src_id, dst_id);
 
         auto optional_enc_src_set = get_by_id(src_id);
         auto optional_enc_dst_set = get_by_id(dst_id);
 
         if (!optional_enc_src_set.has_value()) {
-            debug_stream << ": set #" << src_id << " does not exist" << endl;
+            trace_result(op, trace_result_t::does_not_exist, src_id);
         } else if (!optional_enc_dst_set.has_value()) {
-            debug_stream << ": set #" << dst_id << " does not exist" << endl;
+            trace_result(op, trace_result_t::does_not_exist, dst_id);
+        } else if (optional_enc_dst_set->get().read_only) {
+            trace_result(op, trace_result_t::read_only, dst_id);
         } else {
-            const encrypted_set_t &enc_src_set = optional_enc_src_set->get();
-            encrypted_set_t &enc_dst_set = optional_enc_dst_set->get();
-
-            for (const encrypted_string_t &enc_str : enc_src_set) {
-                if (enc_dst_set.count(enc_str)) {
-                    debug_stream << ": copied cypher " << get_hex_str(enc_str)
-                                 << " was already present in set #" << dst_id
-                                 << endl;
+            set_entry_t &dst_entry = optional_enc_dst_set->get();
+            // Kopia wpisu źródła utrzymuje przy życiu jego zawartość, nawet
+            // gdy zbiór docelowy zacznie ją współdzielić lub zmodyfikuje.
+            const set_entry_t src_entry = optional_enc_src_set->get();
+
+            // Pusty zbiór docelowy może po prostu współdzielić zawartość
+            // źródła, kopia nastąpi dopiero przy jego modyfikacji.
+            bool share = get_size(dst_entry) == 0;
+            if (share) {
+                dst_entry.ciphers = src_entry.ciphers;
+                dst_entry.mapped = src_entry.mapped;
+                if (dst_entry.bloom && src_entry.bloom)
+                    dst_entry.bloom = src_entry.bloom;
+                else if (dst_entry.bloom)
+                    rebuild_bloom(dst_entry);
+            }
+
+            // Przy współdzieleniu pętla służy tylko do rejestrowania zdarzeń.
+            if (share && !debug_enabled)
+                return;
+
+            auto copy_cipher = [&](const encrypted_string_t &enc_str) {
+                if (!share && contains(dst_entry, enc_str)) {
+                    trace_result(op, trace_result_t::copy_already_present,
+                                 src_id, dst_id, enc_str);
                 } else {
-                    enc_dst_set.insert(enc_str);
-                    debug_stream << ": cypher " << get_hex_str(enc_str)
-                                 << " copied from set #" << src_id
-                                 << " to set #" << dst_id << endl;
+                    if (!share) {
+                        get_writable(dst_entry).insert(enc_str);
+                        bloom_inserted(dst_entry, enc_str);
+                    }
+                    trace_result(op, trace_result_t::copied, src_id, dst_id,
+                                 enc_str);
                 }
+            };
+
+            for_each_cipher(src_entry, copy_cipher);
+        }
+    }
+
+    unsigned long encstrset_snapshot(unsigned long id) {
+        const trace_op_t op = trace_op_t::snapshot;
+        trace_call(op, id);
+
+        auto optional_encrypted_set = get_by_id(id);
+
+        if (optional_encrypted_set.has_value()) {
+            set_entry_t snapshot = optional_encrypted_set->get();
+            snapshot.read_only = true;
+            snapshot.bloom_stats = {};
+            unsigned long snapshot_id = encrypted_sets().add(move(snapshot));
+            trace_result(op, trace_result_t::snapshot_created, snapshot_id, id);
+            return snapshot_id;
+        } else {
+            trace_result(op, trace_result_t::does_not_exist, id);
+            return ENCSTRSET_INVALID_ID;
+        }
+    }
+
+    bool encstrset_save(unsigned long id, const char *path) {
+        const trace_op_t op = trace_op_t::save;
+        trace_call(op, id, 0, path);
+
+        if (path == nullptr) {
+            trace_result(op, trace_result_t::invalid_path);
+            return false;
+        }
+
+        auto optional_encrypted_set = get_by_id(id);
+
+        if (!optional_encrypted_set.has_value()) {
+            trace_result(op, trace_result_t::does_not_exist, id);
+            return false;
+        } else if (save_to_file(optional_encrypted_set->get(), path)) {
+            trace_result(op, trace_result_t::saved, id, path);
+            return true;
+        } else {
+            trace_result(op, trace_result_t::save_failed, id, path);
+            return false;
+        }
+    }
+
+    unsigned long encstrset_load(const char *path) {
+        const trace_op_t op = trace_op_t::load;
+        trace_call(op, 0, 0, path);
+
+        if (path == nullptr) {
+            trace_result(op, trace_result_t::invalid_path);
+            return ENCSTRSET_INVALID_ID;
+        }
+
+        shared_ptr<const mapped_set_t> mapped = mapped_set_t::open(path);
+
+        if (mapped) {
+            unsigned long id = encrypted_sets().add(set_entry_t{
+                    nullptr, false, move(mapped)});
+            trace_result(op, trace_result_t::loaded, id, path);
+            return id;
+        } else {
+            trace_result(op, trace_result_t::invalid_file, 0, path);
+            return ENCSTRSET_INVALID_ID;
+        }
+    }
+
+    bool encstrset_set_bloom(unsigned long id, bool enabled) {
+        const trace_op_t op = trace_op_t::set_bloom;
+        trace_call(op, id, enabled);
+
+        auto optional_encrypted_set = get_by_id(id);
+
+        if (optional_encrypted_set.has_value()) {
+            set_entry_t &entry = optional_encrypted_set->get();
+            if (enabled)
+                rebuild_bloom(entry);
+            else
+                entry.bloom = nullptr;
+            entry.bloom_stats = {};
+            trace_result(op, enabled ? trace_result_t::bloom_enabled
+                                     : trace_result_t::bloom_disabled, id);
+            return true;
+        } else {
+            trace_result(op, trace_result_t::does_not_exist, id);
+            return false;
+        }
+    }
+
+    bool encstrset_bloom_stats(unsigned long id,
+                               struct encstrset_bloom_stats_t *stats) {
+        const trace_op_t op = trace_op_t::bloom_stats;
+        trace_call(op, id);
+
+        auto optional_encrypted_set = get_by_id(id);
+
+        if (!optional_encrypted_set.has_value()) {
+            trace_result(op, trace_result_t::does_not_exist, id);
+            return false;
+        } else if (!optional_encrypted_set->get().bloom) {
+            trace_result(op, trace_result_t::no_bloom, id);
+            return false;
+        } else {
+            const bloom_stats_t &counters =
+                    optional_encrypted_set->get().bloom_stats;
+            size_t absent = counters.rejected + counters.false_positives;
+            double rate = absent == 0 ? 0.0
+                                      : double(counters.false_positives) /
+                                        double(absent);
+
+            if (stats != nullptr) {
+                stats->queries = counters.queries;
+                stats->rejected = counters.rejected;
+                stats->false_positives = counters.false_positives;
+                stats->false_positive_rate = rate;
             }
+
+            if (debug_enabled)
+                trace(op, trace_result_t::bloom_stats, id, counters.queries,
+                      counters.rejected, counters.false_positives, no_text,
+                      no_text);
+            return true;
+        }
+    }
+
+    struct encstrset_cursor {
+        // Kopia wpisu zbioru utrzymuje przeglądaną zawartość przy życiu
+        // i niezmienioną, tak jak migawka.
+        set_entry_t entry;
+        encrypted_set_t::const_iterator position;
+        uint64_t bucket;
+    };
+
+    encstrset_cursor *encstrset_cursor_open(unsigned long id) {
+        const trace_op_t op = trace_op_t::cursor_open;
+        trace_call(op, id);
+
+        auto optional_encrypted_set = get_by_id(id);
+
+        if (optional_encrypted_set.has_value()) {
+            auto cursor = new encstrset_cursor{optional_encrypted_set->get(),
+                                               {}, 0};
+            if (!cursor->entry.mapped)
+                cursor->position = cursor->entry.ciphers->cbegin();
+            trace_result(op, trace_result_t::cursor_opened, id);
+            return cursor;
+        } else {
+            trace_result(op, trace_result_t::does_not_exist, id);
+            return nullptr;
+        }
+    }
+
+    bool encstrset_cursor_next(encstrset_cursor *cursor, const char **data,
+                               size_t *length) {
+        if (cursor == nullptr)
+            return false;
+
+        const char *next_data;
+        size_t next_length;
+
+        if (cursor->entry.mapped) {
+            tie(next_data, next_length) =
+                    cursor->entry.mapped->next_record(cursor->bucket);
+            if (next_data == nullptr)
+                return false;
+        } else {
+            if (cursor->position == cursor->entry.ciphers->cend())
+                return false;
+            next_data = cursor->position->data();
+            next_length = cursor->position->size();
+            ++cursor->position;
+        }
+
+        if (data != nullptr)
+            *data = next_data;
+        if (length != nullptr)
+            *length = next_length;
+        return true;
+    }
+
+    void encstrset_cursor_close(encstrset_cursor *cursor) {
+        trace_call(trace_op_t::cursor_close);
+        delete cursor;
+    }
+
+    size_t encstrset_export(unsigned long id, char *buffer, size_t buffer_size) {
+        const trace_op_t op = trace_op_t::export_set;
+        trace_call(op, id, buffer_size);
+
+        auto optional_encrypted_set = get_by_id(id);
+
+        if (!optional_encrypted_set.has_value()) {
+            trace_result(op, trace_result_t::does_not_exist, id);
+            return 0;
         }
+
+        encstrset_cursor cursor{optional_encrypted_set->get(), {}, 0};
+        if (!cursor.entry.mapped)
+            cursor.position = cursor.entry.ciphers->cbegin();
+
+        const char *data;
+        size_t length;
+        size_t required = 0;
+        while (encstrset_cursor_next(&cursor, &data, &length))
+            required += sizeof(uint32_t) + length;
+
+        if (buffer == nullptr || buffer_size < required) {
+            trace_result(op, trace_result_t::export_needs, id, required);
+            return required;
+        }
+
+        cursor.bucket = 0;
+        if (!cursor.entry.mapped)
+            cursor.position = cursor.entry.ciphers->cbegin();
+
+        char *output = buffer;
+        while (encstrset_cursor_next(&cursor, &data, &length)) {
+            auto record_length = uint32_t(length);
+            memcpy(output, &record_length, sizeof(record_length));
+            memcpy(output + sizeof(record_length), data, length);
+            output += sizeof(record_length) + length;
+        }
+
+        trace_result(op, trace_result_t::exported, id, get_size(cursor.entry));
+        return required;
+    }
+
+    void encstrset_trace_echo(bool enabled) {
+        if (debug_enabled)
+            trace_ring().echo = enabled;
+    }
+
+    void encstrset_trace_dump() {
+        if (!debug_enabled)
+            return;
+
+        trace_ring().for_each([](const trace_event_t &event) {
+            const trace_text_t texts[2] = {event.get_text(0), event.get_text(1)};
+            print_event(cerr, event, texts);
+        });
     }
 }
@@ -14,6 +14,9 @@ namespace jnp1 {
     #include<stdlib.h>
 #endif
 
+// Identyfikator zwracany przez funkcje, którym nie udało się utworzyć zbioru.
+#define ENCSTRSET_INVALID_ID ((unsigned long) -1)
+
 // Tworzy nowy zbiór i zwraca jego identyfikator.
 unsigned long encstrset_new();
 
@@ -53,6 +56,96 @@ void encstrset_clear(unsigned long id);
 // dst_id, a w przeciwnym przypadku nic nie robi.
 void encstrset_copy(unsigned long src_id, unsigned long dst_id);
 
+// Jeżeli istnieje zbiór o identyfikatorze id, tworzy jego migawkę tylko do
+// odczytu i zwraca jej identyfikator, a w przeciwnym przypadku zwraca
+// ENCSTRSET_INVALID_ID. Migawka współdzieli zawartość ze zbiorem id, dopóki
+// żaden z nich nie zostanie zmodyfikowany, więc jej utworzenie kosztuje O(1).
+// Próby modyfikacji migawki (insert, remove, clear, copy do migawki) nic nie
+// robią. Migawkę usuwa się funkcją encstrset_delete.
+unsigned long encstrset_snapshot(unsigned long id);
+
+// Jeżeli istnieje zbiór o identyfikatorze id, zapisuje jego zawartość do
+// pliku path i zwraca true, a w przeciwnym przypadku lub w razie błędu zapisu
+// zwraca false. Plik ma postać tablicy haszującej, którą encstrset_load
+// odwzorowuje w pamięć bez deserializacji.
+bool encstrset_save(unsigned long id, const char *path);
+
+// Tworzy nowy zbiór o zawartości pliku zapisanego przez encstrset_save
+// i zwraca jego identyfikator, a w razie błędu zwraca ENCSTRSET_INVALID_ID.
+// Zapytania o taki zbiór są obsługiwane bezpośrednio z odwzorowanego
+// w pamięć pliku, a jego zawartość jest kopiowana do pamięci procesu dopiero
+// przy pierwszej modyfikacji.
+unsigned long encstrset_load(const char *path);
+
+// Jeżeli istnieje zbiór o identyfikatorze id, włącza (enabled == true) lub
+// wyłącza dla niego blokowy filtr Blooma i zwraca true, a w przeciwnym
+// przypadku zwraca false. Filtr jest sprawdzany przez encstrset_test przed
+// właściwym wyszukiwaniem, więc zapytanie o nieobecny element zwykle kosztuje
+// odczyt jednej linii cache. Opłaca się dla zbiorów odpytywanych głównie
+// o elementy, których w nich nie ma.
+bool encstrset_set_bloom(unsigned long id, bool enabled);
+
+// Statystyki zapytań encstrset_test dla zbioru z filtrem Blooma.
+struct encstrset_bloom_stats_t {
+    // Liczba zapytań od włączenia filtra.
+    size_t queries;
+    // Liczba zapytań, na które odpowiedział sam filtr.
+    size_t rejected;
+    // Liczba zapytań przepuszczonych przez filtr o elementy spoza zbioru.
+    size_t false_positives;
+    // false_positives / (rejected + false_positives), 0 bez takich zapytań.
+    double false_positive_rate;
+};
+
+// Jeżeli istnieje zbiór o identyfikatorze id z włączonym filtrem Blooma,
+// zapisuje jego statystyki pod adresem stats (o ile jest różny od NULL)
+// i zwraca true, a w przeciwnym przypadku zwraca false.
+bool encstrset_bloom_stats(unsigned long id,
+                           struct encstrset_bloom_stats_t *stats);
+
+// Kursor przeglądający szyfry zbioru.
+struct encstrset_cursor;
+
+// Jeżeli istnieje zbiór o identyfikatorze id, tworzy kursor przeglądający
+// jego szyfry, a w przeciwnym przypadku zwraca NULL. Kursor widzi zawartość
+// zbioru z chwili utworzenia, tak jak migawka: późniejsze modyfikacje lub
+// usunięcie zbioru go nie unieważniają. Kursor należy zamknąć funkcją
+// encstrset_cursor_close.
+struct encstrset_cursor *encstrset_cursor_open(unsigned long id);
+
+// Jeżeli kursor nie przejrzał jeszcze wszystkich szyfrów, zapisuje pod
+// adresem data wskaźnik na kolejny szyfr, a pod adresem length jego długość
+// i zwraca true, a w przeciwnym przypadku zwraca false. Szyfr nie jest
+// kopiowany: wskaźnik prowadzi do wnętrza zbioru i jest ważny do zamknięcia
+// kursora. Szyfr może zawierać znaki '\0'. Kolejność szyfrów jest
+// nieokreślona.
+bool encstrset_cursor_next(struct encstrset_cursor *cursor, const char **data,
+                           size_t *length);
+
+// Zamyka kursor. Nic nie robi, gdy cursor jest równy NULL.
+void encstrset_cursor_close(struct encstrset_cursor *cursor);
+
+// Jeżeli istnieje zbiór o identyfikatorze id, zwraca liczbę bajtów potrzebną
+// do wyeksportowania jego szyfrów, a w przeciwnym przypadku zwraca 0. Jeżeli
+// bufor buffer ma co najmniej tyle bajtów (buffer_size), zapisuje w nim
+// kolejno wszystkie szyfry jako rekordy [uint32_t długość][bajty szyfru],
+// z długością w natywnej kolejności bajtów i bez wyrównania.
+size_t encstrset_export(unsigned long id, char *buffer, size_t buffer_size);
+
+// Diagnostyka (tylko w wersji skompilowanej bez NDEBUG; w przeciwnym
+// przypadku poniższe funkcje nic nie robią). Każda linia diagnostyki trafia
+// jako binarne zdarzenie do bufora cyklicznego ostatnich 4096 zdarzeń.
+
+// Włącza (domyślnie) lub wyłącza natychmiastowe wypisywanie diagnostyki na
+// standardowe wyjście błędów. Po wyłączeniu zdarzenia są tylko zapisywane
+// w buforze, co kosztuje dziesiątki nanosekund na wywołanie.
+void encstrset_trace_echo(bool enabled);
+
+// Wypisuje na standardowe wyjście błędów zdarzenia z bufora, od
+// najstarszego, w formacie wypisywania natychmiastowego. Argumenty i szyfry
+// dłuższe niż 40 bajtów są skracane i oznaczane wielokropkiem.
+void encstrset_trace_dump(void);
+
 #ifdef __cplusplus
     }
 }
@@ -0,0 +1,52 @@
+#include "../encstrset.h"
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cassert>
+
+using namespace ::jnp1;
+
+int main() {
+    unsigned long id = encstrset_new();
+    encstrset_bloom_stats_t stats{};
+
+    assert(!encstrset_bloom_stats(id, &stats));
+    encstrset_insert(id, "ala", "ma");
+    assert(encstrset_set_bloom(id, true));
+    assert(!encstrset_set_bloom(id + 100, true));
+
+    encstrset_insert(id, "kota", "ma");
+    assert(encstrset_test(id, "ala", "ma"));
+    assert(encstrset_test(id, "kota", "ma"));
+    assert(!encstrset_test(id, "psa", "ma"));
+    assert(!encstrset_test(id, "ala", "ala"));
+
+    assert(encstrset_bloom_stats(id, &stats));
+    assert(stats.queries == 4);
+    assert(stats.rejected + stats.false_positives == 2);
+
+    // Usunięty element nie może zostać uznany za obecny.
+    assert(encstrset_remove(id, "ala", "ma"));
+    assert(!encstrset_test(id, "ala", "ma"));
+
+    // Migawki i kopie korzystają z filtra niezależnie od źródła.
+    unsigned long snap = encstrset_snapshot(id);
+    unsigned long copy = encstrset_new();
+    encstrset_set_bloom(copy, true);
+    encstrset_copy(id, copy);
+    encstrset_insert(id, "psa", "ma");
+    assert(encstrset_test(id, "psa", "ma"));
+    assert(!encstrset_test(snap, "psa", "ma"));
+    assert(encstrset_test(copy, "kota", "ma"));
+    assert(!encstrset_test(copy, "psa", "ma"));
+
+    encstrset_clear(id);
+    assert(!encstrset_test(id, "psa", "ma"));
+    assert(encstrset_size(id) == 0);
+
+    assert(encstrset_set_bloom(id, false));
+    assert(!encstrset_bloom_stats(id, nullptr));
+    assert(encstrset_bloom_stats(copy, nullptr));
+}
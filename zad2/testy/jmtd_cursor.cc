@@ -0,0 +1,88 @@
+#include "../encstrset.h"
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace ::jnp1;
+
+namespace {
+    std::multiset<std::string> scan(unsigned long id) {
+        std::multiset<std::string> result;
+        encstrset_cursor *cursor = encstrset_cursor_open(id);
+        const char *data;
+        size_t length;
+        while (encstrset_cursor_next(cursor, &data, &length))
+            result.emplace(data, length);
+        encstrset_cursor_close(cursor);
+        return result;
+    }
+
+    std::multiset<std::string> export_all(unsigned long id) {
+        size_t required = encstrset_export(id, nullptr, 0);
+        std::vector<char> buffer(required);
+        assert(encstrset_export(id, buffer.data(), buffer.size()) == required);
+
+        std::multiset<std::string> result;
+        for (size_t offset = 0; offset < required;) {
+            uint32_t length;
+            std::memcpy(&length, buffer.data() + offset, sizeof(length));
+            offset += sizeof(length);
+            result.emplace(buffer.data() + offset, length);
+            offset += length;
+        }
+        return result;
+    }
+}
+
+int main() {
+    const std::multiset<std::string> expected = {
+            std::string("\0\0\0", 3), "\x0c\x0d\x0c", std::string("\x06\x0e\x19\0", 4)};
+
+    unsigned long id = encstrset_new();
+    encstrset_insert(id, "ala", "ala");
+    encstrset_insert(id, "ala", "ma");
+    encstrset_insert(id, "kota", "ma");
+
+    assert(scan(id) == expected);
+    assert(export_all(id) == expected);
+
+    // Kursor widzi zawartość z chwili utworzenia.
+    encstrset_cursor *cursor = encstrset_cursor_open(id);
+    encstrset_clear(id);
+    encstrset_delete(id);
+    size_t count = 0;
+    while (encstrset_cursor_next(cursor, nullptr, nullptr))
+        count++;
+    assert(count == 3);
+    assert(!encstrset_cursor_next(cursor, nullptr, nullptr));
+    encstrset_cursor_close(cursor);
+
+    // Zbiór wczytany z pliku.
+    const char *path = "jmtd_cursor.set";
+    unsigned long saved = encstrset_new();
+    encstrset_insert(saved, "ala", "ala");
+    encstrset_insert(saved, "ala", "ma");
+    encstrset_insert(saved, "kota", "ma");
+    assert(encstrset_save(saved, path));
+    unsigned long loaded = encstrset_load(path);
+    assert(scan(loaded) == expected);
+    assert(export_all(loaded) == expected);
+    std::remove(path);
+
+    // Za mały bufor i nieistniejący zbiór.
+    char small[4];
+    assert(encstrset_export(saved, small, sizeof(small)) == 22);
+    assert(encstrset_cursor_open(id) == nullptr);
+    assert(!encstrset_cursor_next(nullptr, nullptr, nullptr));
+    encstrset_cursor_close(nullptr);
+    assert(encstrset_export(id, nullptr, 0) == 0);
+}
@@ -0,0 +1,82 @@
+#include "../encstrset.h"
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace ::jnp1;
+
+int main() {
+    const char *path = "jmtd_save_load.set";
+    const char *invalid_path = "jmtd_save_load.invalid";
+
+    unsigned long id = encstrset_new();
+    encstrset_insert(id, "ala", "ma");
+    encstrset_insert(id, "kota", "ma");
+    encstrset_insert(id, "a\x01", "a");
+    assert(encstrset_save(id, path));
+    assert(!encstrset_save(id + 100, path));
+
+    unsigned long loaded = encstrset_load(path);
+    assert(loaded != ENCSTRSET_INVALID_ID);
+    assert(encstrset_size(loaded) == 3);
+    assert(encstrset_test(loaded, "ala", "ma"));
+    assert(encstrset_test(loaded, "kota", "ma"));
+    assert(encstrset_test(loaded, "a\x01", "a"));
+    assert(!encstrset_test(loaded, "psa", "ma"));
+
+    // Migawka i kopia zbioru wczytanego z pliku.
+    unsigned long snap = encstrset_snapshot(loaded);
+    unsigned long copy = encstrset_new();
+    encstrset_copy(loaded, copy);
+
+    // Pierwsza modyfikacja kopiuje zawartość do pamięci procesu.
+    assert(encstrset_insert(loaded, "psa", "ma"));
+    assert(!encstrset_insert(loaded, "ala", "ma"));
+    assert(encstrset_remove(loaded, "kota", "ma"));
+    assert(encstrset_size(loaded) == 3);
+    assert(encstrset_size(snap) == 3);
+    assert(encstrset_test(snap, "kota", "ma"));
+    assert(encstrset_size(copy) == 3);
+
+    // Zapis do pliku, z którego wczytano zbiór, nie zmienia wczytanego
+    // zbioru (jest odwzorowany w pamięci ze starej wersji pliku).
+    unsigned long big = encstrset_new();
+    encstrset_trace_echo(false);
+    for (int i = 0; i < 20000; i++)
+        encstrset_insert(big, std::to_string(i).c_str(), "k");
+    encstrset_trace_echo(true);
+    assert(encstrset_save(big, path));
+    unsigned long loaded_big = encstrset_load(path);
+    assert(encstrset_size(loaded_big) == 20000);
+    unsigned long single = encstrset_new();
+    encstrset_insert(single, "x", "k");
+    assert(encstrset_save(single, path));
+    assert(encstrset_size(loaded_big) == 20000);
+    assert(encstrset_test(loaded_big, "19999", "k"));
+    assert(!encstrset_test(loaded_big, "x", "k"));
+    unsigned long reloaded = encstrset_load(path);
+    assert(encstrset_size(reloaded) == 1);
+    assert(encstrset_test(reloaded, "x", "k"));
+
+    // Pusty zbiór.
+    unsigned long empty = encstrset_new();
+    assert(encstrset_save(empty, path));
+    unsigned long loaded_empty = encstrset_load(path);
+    assert(encstrset_size(loaded_empty) == 0);
+    assert(!encstrset_test(loaded_empty, "", nullptr));
+
+    // Niepoprawne pliki.
+    std::ofstream(invalid_path) << "to nie jest zbior";
+    assert(encstrset_load(invalid_path) == ENCSTRSET_INVALID_ID);
+    assert(encstrset_load("jmtd_save_load.missing") == ENCSTRSET_INVALID_ID);
+    assert(encstrset_load(nullptr) == ENCSTRSET_INVALID_ID);
+
+    std::remove(path);
+    std::remove(invalid_path);
+}
@@ -0,0 +1,50 @@
+#include "../encstrset.h"
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cassert>
+
+using namespace ::jnp1;
+
+int main() {
+    unsigned long id = encstrset_new();
+    encstrset_insert(id, "ala", "ma");
+    encstrset_insert(id, "kota", "ma");
+
+    unsigned long snap = encstrset_snapshot(id);
+    assert(snap != ENCSTRSET_INVALID_ID);
+    assert(encstrset_size(snap) == 2);
+    assert(encstrset_test(snap, "ala", "ma"));
+
+    // Modyfikacje zbioru nie są widoczne w migawce.
+    assert(encstrset_insert(id, "psa", "ma"));
+    assert(encstrset_remove(id, "ala", "ma"));
+    assert(encstrset_size(id) == 2);
+    assert(encstrset_size(snap) == 2);
+    assert(encstrset_test(snap, "ala", "ma"));
+    assert(!encstrset_test(snap, "psa", "ma"));
+
+    // Migawka jest tylko do odczytu.
+    assert(!encstrset_insert(snap, "psa", "ma"));
+    assert(!encstrset_remove(snap, "ala", "ma"));
+    encstrset_clear(snap);
+    encstrset_copy(id, snap);
+    assert(encstrset_size(snap) == 2);
+
+    // Migawka przeżywa usunięcie zbioru źródłowego.
+    encstrset_delete(id);
+    assert(encstrset_test(snap, "kota", "ma"));
+
+    // Kopia do pustego zbioru współdzieli zawartość aż do modyfikacji.
+    unsigned long copy = encstrset_new();
+    encstrset_copy(snap, copy);
+    assert(encstrset_insert(copy, "psa", "ma"));
+    assert(encstrset_size(copy) == 3);
+    assert(encstrset_size(snap) == 2);
+
+    assert(encstrset_snapshot(id) == ENCSTRSET_INVALID_ID);
+    encstrset_delete(snap);
+    encstrset_delete(copy);
+}
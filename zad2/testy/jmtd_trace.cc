@@ -0,0 +1,32 @@
+#include "../encstrset.h"
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cassert>
+
+using namespace ::jnp1;
+
+int main() {
+    // Bez echa zdarzenia trafiają tylko do bufora.
+    encstrset_trace_echo(false);
+
+    unsigned long id = encstrset_new();
+    encstrset_insert(id, "ala", "ma");
+    encstrset_insert(id, "ala", "ma");
+    encstrset_insert(id, "bardzo dlugi napis, dluzszy niz czterdziesci znakow",
+                     nullptr);
+    assert(encstrset_test(id, "ala", "ma"));
+    encstrset_insert(id, nullptr, "ma");
+    unsigned long copy = encstrset_new();
+    encstrset_copy(id, copy);
+    encstrset_delete(id);
+    encstrset_remove(id, "ala", "ma");
+
+    // Zrzut odtwarza zwykły format diagnostyki.
+    encstrset_trace_dump();
+
+    encstrset_trace_echo(true);
+    encstrset_delete(copy);
+}
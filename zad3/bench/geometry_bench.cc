@@ -0,0 +1,326 @@
+// Benchmark operacji geometrycznych.
+//
+// Dla każdego rozmiaru kolekcji mierzy przesunięcie (operator+=), porównanie
+// (operator==), odbicie, sumę pól i scalanie (merge_all, merge_tiling) dla
+// układu tablicy struktur (Rectangles, Rectangles16), struktury tablic
+// (RectanglesSoA) i wersji równoległych z geometry_parallel.h. Osobno
+// porównuje algorytmy zamiatania z naiwną pętlą po parach, mierzy budowę
+// i zapytania IndexedRectangles oraz wstawianie do StreamingMerger.
+//
+// Każdy pomiar jest powtarzany, aż łącznie obejmie ok. 10^7 prostokątów;
+// wypisywany jest czas na prostokąt (dla zapytań: na zapytanie): najlepszy
+// i średni.
+//
+// Użycie: geometry_bench [--quick] [--max-size N]
+//   --quick       rozmiary do 10^5 (do szybkiego sprawdzenia zmian),
+//   --max-size N  pomija kolekcje większe niż N (domyślnie 10^7).
+
+#include "../geometry.h"
+#include "../rectangles_soa.h"
+#include "../spatial_index.h"
+#include "../streaming_merger.h"
+#include "../sweep_line.h"
+
+#ifdef GEOMETRY_BENCH_PARALLEL
+#include "../geometry_parallel.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    using bench_clock = std::chrono::steady_clock;
+
+    // Zapobiega usunięciu mierzonych obliczeń przez kompilator.
+    volatile int64_t sink;
+
+    // Zbiera czasy powtórzeń jednej operacji i wypisuje ich podsumowanie.
+    class timing_t {
+    private:
+        std::vector<double> samples_ns;
+
+    public:
+        template<typename F>
+        void measure(F f) {
+            auto start = bench_clock::now();
+            f();
+            auto stop = bench_clock::now();
+            samples_ns.push_back(
+                    std::chrono::duration<double, std::nano>(stop - start).count());
+        }
+
+        // Czasy są dzielone przez units: liczbę prostokątów lub zapytań.
+        void report(const char *operation, const char *layout, size_t size,
+                    size_t units) {
+            double total = 0;
+            for (double sample : samples_ns)
+                total += sample;
+            double best = *std::min_element(samples_ns.begin(), samples_ns.end());
+            double per_rect = double(std::max<size_t>(units, 1));
+
+            std::printf("%-14s %-8s %9zu %7zu %12.3f %12.3f\n", operation, layout,
+                        size, samples_ns.size(), best / per_rect,
+                        total / double(samples_ns.size()) / per_rect);
+        }
+    };
+
+    size_t repetitions(size_t size) {
+        return std::clamp<size_t>(10000000 / std::max<size_t>(size, 1), 3, 1000);
+    }
+
+    template<typename F>
+    void bench(const char *operation, const char *layout, size_t size,
+               size_t units, F f) {
+        timing_t timing;
+        size_t count = repetitions(std::max(size, units));
+        for (size_t i = 0; i < count; i++)
+            timing.measure(f);
+        timing.report(operation, layout, size, units);
+    }
+
+    template<typename F>
+    void bench(const char *operation, const char *layout, size_t size, F f) {
+        bench(operation, layout, size, size, f);
+    }
+
+    // Losowe prostokąty o współrzędnych z [0, 2 * extent) i bokach z [1, side].
+    template<typename T>
+    std::vector<BasicRectangle<T>> make_rectangles(size_t count, T extent,
+                                                   T side, std::mt19937 &rng) {
+        std::uniform_int_distribution<int64_t> coordinate(0, 2 * int64_t(extent) - 1);
+        std::uniform_int_distribution<int64_t> length(1, side);
+        std::vector<BasicRectangle<T>> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            result.emplace_back(T(length(rng)), T(length(rng)),
+                                BasicPosition<T>(T(coordinate(rng)),
+                                                 T(coordinate(rng))));
+        }
+        return result;
+    }
+
+    // Pas prostokątów 1x1 ułożonych wzdłuż osi x: merge_all scala go
+    // w jednym przebiegu, a merge_tiling dostaje go w losowej kolejności.
+    Rectangles make_strip(size_t count, std::mt19937 &rng, bool shuffled) {
+        std::vector<Rectangle> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            result.emplace_back(1, 1, Position(int(i), 0));
+        if (shuffled)
+            std::shuffle(result.begin(), result.end(), rng);
+        return Rectangles(std::move(result));
+    }
+
+    // Naiwne O(n^2) przejście po parach, odpowiednik intersecting_pairs.
+    size_t naive_pair_count(const Rectangles &rects) {
+        size_t count = 0;
+        for (size_t i = 0; i < rects.size(); i++) {
+            const Rectangle &a = rects[i];
+            for (size_t j = i + 1; j < rects.size(); j++) {
+                const Rectangle &b = rects[j];
+                if (a.pos().x() < b.pos().x() + b.width() &&
+                    b.pos().x() < a.pos().x() + a.width() &&
+                    a.pos().y() < b.pos().y() + b.height() &&
+                    b.pos().y() < a.pos().y() + a.height())
+                    count++;
+            }
+        }
+        return count;
+    }
+
+    void run_bulk(size_t size, std::mt19937 &rng) {
+        // Przesunięcia tam i z powrotem utrzymują współrzędne w zakresie.
+        Vector forward(3, -2);
+        Vector backward(-3, 2);
+        Vector16 forward16(3, -2);
+        Vector16 backward16(-3, 2);
+        bool flip = false;
+
+        Rectangles aos(make_rectangles<int>(size, 1000000, 1000, rng));
+        Rectangles aos_copy(aos);
+        Rectangles16 aos16(make_rectangles<int16_t>(size, 10000, 100, rng));
+        RectanglesSoA soa(aos);
+        RectanglesSoA soa_copy(aos);
+
+        // Po każdym pomiarze cofamy ewentualne nieparzyste przesunięcie, żeby
+        // aos i soa pozostały równe swoim kopiom.
+        bench("translate", "aos", size, [&] {
+            aos += (flip = !flip) ? forward : backward;
+        });
+        if (std::exchange(flip, false))
+            aos += backward;
+        bench("translate", "aos16", size, [&] {
+            aos16 += (flip = !flip) ? forward16 : backward16;
+        });
+        if (std::exchange(flip, false))
+            aos16 += backward16;
+        bench("translate", "soa", size, [&] {
+            soa += (flip = !flip) ? forward : backward;
+        });
+        if (std::exchange(flip, false))
+            soa += backward;
+#ifdef GEOMETRY_BENCH_PARALLEL
+        bench("translate", "par", size, [&] {
+            translate(std::execution::par_unseq, aos,
+                      (flip = !flip) ? forward : backward);
+        });
+        if (std::exchange(flip, false))
+            aos += backward;
+#endif
+
+        bench("equal", "aos", size, [&] { sink = aos == aos_copy; });
+        bench("equal", "soa", size, [&] { sink = soa == soa_copy; });
+#ifdef GEOMETRY_BENCH_PARALLEL
+        bench("equal", "par", size, [&] {
+            sink = equal(std::execution::par, aos, aos_copy);
+        });
+#endif
+
+        bench("reflection", "aos", size, [&] {
+            sink = int64_t(aos.reflection().size());
+        });
+        bench("reflection", "soa", size, [&] {
+            sink = int64_t(soa.reflection().size());
+        });
+#ifdef GEOMETRY_BENCH_PARALLEL
+        bench("reflection", "par", size, [&] {
+            sink = int64_t(reflection(std::execution::par_unseq, aos).size());
+        });
+#endif
+
+        bench("area", "aos", size, [&] { sink = aos.area(); });
+        bench("area", "aos16", size, [&] { sink = aos16.area(); });
+        bench("area", "soa", size, [&] { sink = soa.area_sum(); });
+#ifdef GEOMETRY_BENCH_PARALLEL
+        bench("area", "par", size, [&] {
+            sink = area(std::execution::par_unseq, aos);
+        });
+#endif
+    }
+
+    void run_merge(size_t size, std::mt19937 &rng) {
+        Rectangles strip = make_strip(size, rng, false);
+        Rectangles shuffled = make_strip(size, rng, true);
+
+        bench("merge_all", "aos", size, [&] {
+            sink = merge_all(strip).width();
+        });
+        bench("merge_tiling", "aos", size, [&] {
+            sink = int64_t(merge_tiling(shuffled).status);
+        });
+    }
+
+    void run_index(size_t size, std::mt19937 &rng) {
+        int extent = int(std::max<size_t>(100, size_t(10 * std::sqrt(double(size)))));
+        Rectangles rects(make_rectangles<int>(size, extent, 10, rng));
+        Rectangles queries(make_rectangles<int>(1000, extent, 10, rng));
+
+        bench("index_build", "index", size, [&] {
+            sink = int64_t(IndexedRectangles(rects).size());
+        });
+
+        IndexedRectangles index(rects);
+        bench("containing", "index", size, queries.size(), [&] {
+            size_t found = 0;
+            for (const Rectangle &query : queries)
+                found += index.containing(query.pos()).size();
+            sink = int64_t(found);
+        });
+        bench("overlapping", "index", size, queries.size(), [&] {
+            size_t found = 0;
+            for (const Rectangle &query : queries)
+                found += index.overlapping(query).size();
+            sink = int64_t(found);
+        });
+        bench("nearest", "index", size, queries.size(), [&] {
+            size_t found = 0;
+            for (const Rectangle &query : queries)
+                found += index.nearest(query.pos()).value_or(0);
+            sink = int64_t(found);
+        });
+    }
+
+    void run_streaming(size_t size, std::mt19937 &rng) {
+        // Pas w losowej kolejności scala się kaskadowo, losowe prostokąty
+        // prawie nigdy.
+        Rectangles shuffled = make_strip(size, rng, true);
+        Rectangles rects(make_rectangles<int>(size, 1000000, 1000, rng));
+
+        bench("stream_insert", "strip", size, [&] {
+            StreamingMerger merger;
+            for (const Rectangle &rect : shuffled)
+                merger.insert(rect);
+            sink = int64_t(merger.size());
+        });
+        bench("stream_insert", "random", size, [&] {
+            StreamingMerger merger;
+            for (const Rectangle &rect : rects)
+                merger.insert(rect);
+            sink = int64_t(merger.size());
+        });
+    }
+
+    void run_sweep(size_t size, std::mt19937 &rng) {
+        // Średnio kilka przecięć na prostokąt niezależnie od rozmiaru.
+        int extent = int(std::max<size_t>(100, size_t(10 * std::sqrt(double(size)))));
+        Rectangles rects(make_rectangles<int>(size, extent, 10, rng));
+
+        bench("union_area", "sweep", size, [&] { sink = union_area(rects); });
+        bench("pairs", "sweep", size, [&] {
+            sink = int64_t(intersecting_pairs(rects).size());
+        });
+        if (size <= 10000) {
+            bench("pairs", "naive", size, [&] {
+                sink = int64_t(naive_pair_count(rects));
+            });
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t max_size = 10000000;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            max_size = std::min<size_t>(max_size, 100000);
+        } else if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+            max_size = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "usage: %s [--quick] [--max-size N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<size_t> sizes = {10, 1000, 100000, 1000000, 10000000};
+    std::mt19937 rng(2020);
+
+#ifdef GEOMETRY_BENCH_PARALLEL
+    std::printf("# geometry benchmark, parallel paths on\n");
+#else
+    std::printf("# geometry benchmark, parallel paths off (no TBB)\n");
+#endif
+    std::printf("%-14s %-8s %9s %7s %12s %12s\n", "operation", "layout", "size",
+                "reps", "best_ns/rect", "mean_ns/rect");
+
+    for (size_t size : sizes) {
+        if (size > max_size)
+            break;
+        run_bulk(size, rng);
+        run_merge(size, rng);
+        // Zamiatanie, indeks i scalanie strumieniowe budują struktury
+        // pomocnicze, więc ograniczamy rozmiar.
+        if (size <= 1000000) {
+            run_sweep(size, rng);
+            run_index(size, rng);
+            run_streaming(size, rng);
+        }
+    }
+}
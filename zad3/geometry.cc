@@ -1,239 +1,340 @@
 #include "geometry.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-// Position
+// BasicRectangles
 
 // konstruktory
-Position::Position(int x, int y) : x_(x), y_(y) {}
+template <typename T>
+BasicRectangles<T>::BasicRectangles(
+        std::initializer_list<BasicRectangle<T>> rect) : rectangles_(rect) {}
 
-Position::Position(const Vector &vec) : x_(vec.x()), y_(vec.y()) {}
-
-// gettery
-int Position::x() const {
-    return x_;
-}
-
-int Position::y() const {
-    return y_;
-}
+template <typename T>
+BasicRectangles<T>::BasicRectangles(std::vector<BasicRectangle<T>> rects)
+        : rectangles_(std::move(rects)) {}
 
 // metody
-Position Position::reflection() const {
-    return Position(y_, x_);
-}
-
-const Position Position::origin() {
-    return Position(0, 0);
-}
-
-// operatory
-Position &Position::operator+=(const Vector &vector) {
-    x_ += vector.x();
-    y_ += vector.y();
-    return *this;
-}
-
-
-// Vector
-
-// konstruktory
-Vector::Vector(int x, int y) : coords_(x, y) {}
-
-Vector::Vector(const Position &pos) : coords_(pos.x(), pos.y()) {}
-
-// gettery
-int Vector::x() const {
-    return coords_.x();
+template <typename T>
+size_t BasicRectangles<T>::size() const {
+    return rectangles_.size();
 }
 
-int Vector::y() const {
-    return coords_.y();
+template <typename T>
+void BasicRectangles<T>::reserve(size_t capacity) {
+    rectangles_.reserve(capacity);
 }
 
-// metody
-Vector Vector::reflection() const {
-    return Vector(coords_.reflection());
+template <typename T>
+void BasicRectangles<T>::push_back(const BasicRectangle<T> &rect) {
+    rectangles_.push_back(rect);
 }
 
-// operatory
-Vector &Vector::operator+=(const Vector &vector) {
-    coords_ += vector;
+template <typename T>
+BasicRectangles<T> &BasicRectangles<T>::append(const BasicRectangles &rects) {
+    // vector::insert nie dopuszcza zakresu z tego samego wektora.
+    size_t count = rects.size();
+    rectangles_.reserve(size() + count);
+    for (size_t index = 0; index < count; ++index) {
+        rectangles_.push_back(rects.rectangles_[index]);
+    }
     return *this;
 }
 
-
-// Rectangle
-
-// konstruktory
-Rectangle::Rectangle(int width, int height,
-                     const Position &pos)
-        : width_(width), height_(height), bottomLeftCorner_(pos) {
-    assert(width > 0 && height > 0);
-}
-
-Rectangle::Rectangle(int width, int height)
-        : width_(width), height_(height), bottomLeftCorner_(Position{0, 0}) {
-    assert(width > 0 && height > 0);
-}
-
-// gettery
-int Rectangle::width() const {
-    return width_;
+template <typename T>
+BasicRectangles<T> &BasicRectangles<T>::append(BasicRectangles &&rects) {
+    // Dołączenie do samego siebie podwaja zbiór, więc nie wolno go opróżnić.
+    if (&rects == this) {
+        return append(static_cast<const BasicRectangles &>(rects));
+    }
+    if (rectangles_.empty()) {
+        rectangles_ = std::move(rects.rectangles_);
+    } else {
+        append(rects);
+    }
+    rects.rectangles_.clear();
+    return *this;
 }
 
-int Rectangle::height() const {
-    return height_;
+template <typename T>
+BasicRectangles<T> BasicRectangles<T>::reflection() const {
+    BasicRectangles result(*this);
+    for (BasicRectangle<T> &rect : result.rectangles_) {
+        rect = rect.reflection();
+    }
+    return result;
 }
 
-Position Rectangle::pos() const {
-    return bottomLeftCorner_;
+template <typename T>
+int64_t BasicRectangles<T>::area() const {
+    int64_t result = 0;
+    for (const BasicRectangle<T> &rect : rectangles_) {
+        if (__builtin_add_overflow(result, rect.area(), &result)) {
+            throw std::overflow_error("geometry: area overflow");
+        }
+    }
+    return result;
 }
 
-// metody
-Rectangle Rectangle::reflection() const {
-    return Rectangle(height_, width_, bottomLeftCorner_.reflection());
+// iteratory
+template <typename T>
+typename BasicRectangles<T>::iterator BasicRectangles<T>::begin() {
+    return rectangles_.begin();
 }
 
-int Rectangle::area() const {
-    return width_ * height_;
+template <typename T>
+typename BasicRectangles<T>::iterator BasicRectangles<T>::end() {
+    return rectangles_.end();
 }
 
-// operatory
-Rectangle &Rectangle::operator+=(const Vector &vector) {
-    bottomLeftCorner_ += vector;
-    return *this;
+template <typename T>
+typename BasicRectangles<T>::const_iterator BasicRectangles<T>::begin() const {
+    return rectangles_.begin();
 }
 
-
-// Rectangles
-
-// konstruktory
-Rectangles::Rectangles(std::initializer_list<Rectangle> rect) : rectangles_(
-        rect) {}
-
-// metody
-size_t Rectangles::size() const {
-    return rectangles_.size();
+template <typename T>
+typename BasicRectangles<T>::const_iterator BasicRectangles<T>::end() const {
+    return rectangles_.end();
 }
 
 // operatory
-Rectangles &Rectangles::operator+=(const Vector &vector) {
-    for (auto itr = rectangles_.begin(); itr < rectangles_.end(); ++itr) {
-        *itr += vector;
+template <typename T>
+BasicRectangles<T> &BasicRectangles<T>::operator+=(
+        const BasicVector<T> &vector) {
+    // Jeden przebieg bez rozgałęzień zbiera flagi przepełnienia; w rzadkim
+    // przypadku błędu cofamy przesunięcie, żeby kolekcja się nie zmieniła.
+    bool overflow = false;
+    for (BasicRectangle<T> &rect : rectangles_) {
+        overflow |= rect.wrapping_translate(vector);
+    }
+    if (overflow) {
+        for (BasicRectangle<T> &rect : rectangles_) {
+            rect.wrapping_untranslate(vector);
+        }
+        throw std::overflow_error("geometry: integer overflow");
     }
     return *this;
 }
 
-const Rectangle &Rectangles::operator[](size_t position) const {
+template <typename T>
+const BasicRectangle<T> &BasicRectangles<T>::operator[](size_t position) const {
     assert(position < size());
     return rectangles_[position];
 }
 
-Rectangle &Rectangles::operator[](size_t position){
+template <typename T>
+BasicRectangle<T> &BasicRectangles<T>::operator[](size_t position) {
     assert(position < size());
     return rectangles_[position];
 }
 
-bool Rectangles::operator==(const Rectangles &rects) const {
+template <typename T>
+bool BasicRectangles<T>::operator==(const BasicRectangles &rects) const {
     return rectangles_ == rects.rectangles_;
 }
 
 
 // operatory non-member
-bool operator==(const Position &a, const Position &b) {
-    if (a.x() == b.x() && a.y() == b.y()) {
-        return true;
-    } else {
-        return false;
-    }
-}
-
-bool operator==(const Vector &a, const Vector &b) {
-    if (a.x() == b.x() && a.y() == b.y()) {
-        return true;
-    } else {
-        return false;
-    }
+// Argument jest przekazywany przez wartość, więc dla r-wartości nie ma
+// kopiowania, a wynik jest przenoszony z parametru.
+template <typename T>
+BasicRectangles<T> operator+(BasicRectangles<T> a, const BasicVector<T> &b) {
+    a += b;
+    return a;
 }
 
-bool operator==(const Rectangle &a, const Rectangle &b) {
-    if (a.pos() == b.pos() && a.width() == b.width() &&
-        a.height() == b.height()) {
-        return true;
-    } else {
-        return false;
-    }
-}
-
-Position operator+(Position a, const Vector &b) {
-    return a += b;
-}
-
-Position operator+(const Vector &a, Position b) {
-    return b += a;
-}
-
-Vector operator+(Vector a, const Vector &b) {
-    return a += b;
-}
-
-Rectangle operator+(Rectangle a, const Vector &b) {
-    return a += b;
-}
-
-Rectangle operator+(const Vector &a, Rectangle b) {
-    return b += a;
-}
-
-Rectangles operator+(Rectangles a, const Vector &b) {
-    return a += b;
-}
-
-Rectangles operator+(const Vector &a, Rectangles b) {
-    return b += a;
+template <typename T>
+BasicRectangles<T> operator+(const BasicVector<T> &a, BasicRectangles<T> b) {
+    b += a;
+    return b;
 }
 
 
 // operacje merge
-bool can_merge_horizontally(const Rectangle &rect1, const Rectangle &rect2) {
+// Prostokąt, którego krawędź wychodzi poza zakres T, nie zgłasza
+// przepełnienia, tylko po prostu nie daje się scalić.
+template <typename T>
+bool can_merge_horizontally(const BasicRectangle<T> &rect1,
+                            const BasicRectangle<T> &rect2) {
+    T top = 0;
     return rect1.width() == rect2.width() &&
-           rect1.pos() + Vector(0, rect1.height()) == rect2.pos();
+           rect1.pos().x() == rect2.pos().x() &&
+           !__builtin_add_overflow(rect1.pos().y(), rect1.height(), &top) &&
+           top == rect2.pos().y();
 }
 
-bool can_merge_vertically(const Rectangle &rect1, const Rectangle &rect2) {
+template <typename T>
+bool can_merge_vertically(const BasicRectangle<T> &rect1,
+                          const BasicRectangle<T> &rect2) {
+    T right = 0;
     return rect1.height() == rect2.height() &&
-           rect1.pos() + Vector(rect1.width(), 0) == rect2.pos();
+           rect1.pos().y() == rect2.pos().y() &&
+           !__builtin_add_overflow(rect1.pos().x(), rect1.width(), &right) &&
+           right == rect2.pos().x();
 }
 
-Rectangle merge_horizontally(const Rectangle &rect1, const Rectangle &rect2) {
+template <typename T>
+BasicRectangle<T> merge_horizontally(const BasicRectangle<T> &rect1,
+                                     const BasicRectangle<T> &rect2) {
     assert(can_merge_horizontally(rect1, rect2));
 
-    return Rectangle(rect1.width(), rect1.height() + rect2.height(),
-                     rect1.pos());
+    return BasicRectangle<T>(rect1.width(),
+                             checked_add(rect1.height(), rect2.height()),
+                             rect1.pos());
 }
 
-Rectangle merge_vertically(const Rectangle &rect1, const Rectangle &rect2) {
+template <typename T>
+BasicRectangle<T> merge_vertically(const BasicRectangle<T> &rect1,
+                                   const BasicRectangle<T> &rect2) {
     assert(can_merge_vertically(rect1, rect2));
 
-    return Rectangle(rect1.width() + rect2.width(), rect1.height(),
-                     rect1.pos());
+    return BasicRectangle<T>(checked_add(rect1.width(), rect2.width()),
+                             rect1.height(), rect1.pos());
 }
 
-// friend of Rectangle
-Rectangle merge_all(const Rectangles &rects) {
+// friend of BasicRectangle
+template <typename T>
+BasicRectangle<T> merge_all(const BasicRectangles<T> &rects) {
     assert(rects.size() > 0);
 
-    auto result = Rectangle(rects[0]);
+    auto result = BasicRectangle<T>(rects[0]);
     for (size_t index = 1; index < rects.size(); ++index) {
         if (can_merge_horizontally(result, rects[index])) {
-            result.height_ += rects[index].height_;
+            result.height_ = checked_add(result.height_, rects[index].height_);
         } else if (can_merge_vertically(result, rects[index])) {
-            result.width_ += rects[index].width_;
+            result.width_ = checked_add(result.width_, rects[index].width_);
         } else {
             assert(false);
         }
     }
     return result;
 }
+
+// Prostokąty dokładnie pokrywają swój prostokąt ograniczający wtedy i tylko
+// wtedy, gdy suma ich pól jest równa jego polu, a każdy wierzchołek
+// występuje parzystą liczbę razy, z wyjątkiem czterech narożników prostokąta
+// ograniczającego, które występują dokładnie raz.
+template <typename T>
+BasicMergeResult<T> merge_tiling(const BasicRectangles<T> &rects) {
+    using result_t = BasicMergeResult<T>;
+    if (rects.size() == 0) {
+        return result_t{MergeStatus::empty, std::nullopt};
+    }
+
+    // Typ, w którym nie przepełniają się krawędzie i pola prostokątów.
+    using wide_t = std::conditional_t<(sizeof(T) < sizeof(int64_t)), int64_t,
+                                      __int128>;
+    using corner_t = std::pair<wide_t, wide_t>;
+
+    wide_t min_x = rects[0].pos().x();
+    wide_t min_y = rects[0].pos().y();
+    wide_t max_x = min_x;
+    wide_t max_y = min_y;
+    wide_t area_sum = 0;
+    std::vector<corner_t> corners;
+    corners.reserve(4 * rects.size());
+
+    for (size_t index = 0; index < rects.size(); ++index) {
+        const BasicRectangle<T> &rect = rects[index];
+        wide_t x1 = rect.pos().x();
+        wide_t y1 = rect.pos().y();
+        wide_t x2 = x1 + rect.width();
+        wide_t y2 = y1 + rect.height();
+
+        min_x = std::min(min_x, x1);
+        min_y = std::min(min_y, y1);
+        max_x = std::max(max_x, x2);
+        max_y = std::max(max_y, y2);
+        if (__builtin_add_overflow(
+                area_sum, static_cast<wide_t>(rect.width()) * rect.height(),
+                &area_sum)) {
+            return result_t{MergeStatus::too_large, std::nullopt};
+        }
+
+        corners.emplace_back(x1, y1);
+        corners.emplace_back(x1, y2);
+        corners.emplace_back(x2, y1);
+        corners.emplace_back(x2, y2);
+    }
+
+    // Pole większe niż zakres wide_t na pewno przekracza sumę pól.
+    wide_t bounding_area = 0;
+    if (__builtin_mul_overflow(max_x - min_x, max_y - min_y,
+                               &bounding_area) ||
+        area_sum < bounding_area) {
+        return result_t{MergeStatus::gap, std::nullopt};
+    } else if (area_sum > bounding_area) {
+        return result_t{MergeStatus::overlap, std::nullopt};
+    }
+
+    // Pola się zgadzają, więc każda dziura oznacza też nakładanie się.
+    std::sort(corners.begin(), corners.end());
+    std::vector<corner_t> odd_corners;
+    for (size_t begin = 0; begin < corners.size();) {
+        size_t end = begin;
+        while (end < corners.size() && corners[end] == corners[begin]) {
+            ++end;
+        }
+        if ((end - begin) % 2 == 1) {
+            odd_corners.push_back(corners[begin]);
+        }
+        begin = end;
+    }
+
+    std::vector<corner_t> expected = {{min_x, min_y}, {min_x, max_y},
+                                      {max_x, min_y}, {max_x, max_y}};
+    if (odd_corners != expected) {
+        return result_t{MergeStatus::overlap, std::nullopt};
+    }
+
+    // Narożniki prostokąta ograniczającego nie mogą należeć do więcej niż
+    // jednego prostokąta.
+    for (const corner_t &corner : expected) {
+        auto range = std::equal_range(corners.begin(), corners.end(), corner);
+        if (range.second - range.first != 1) {
+            return result_t{MergeStatus::overlap, std::nullopt};
+        }
+    }
+
+    if (max_x - min_x > std::numeric_limits<T>::max() ||
+        max_y - min_y > std::numeric_limits<T>::max()) {
+        return result_t{MergeStatus::too_large, std::nullopt};
+    }
+
+    return result_t{MergeStatus::success,
+                    BasicRectangle<T>(static_cast<T>(max_x - min_x),
+                                      static_cast<T>(max_y - min_y),
+                                      BasicPosition<T>(static_cast<T>(min_x),
+                                                       static_cast<T>(min_y)))};
+}
+
+
+// Jawne konkretyzacje dla obsługiwanych typów współrzędnych.
+#define GEOMETRY_INSTANTIATE(T)                                               \
+    template class BasicRectangles<T>;                                        \
+    template BasicRectangles<T> operator+(BasicRectangles<T> a,               \
+                                          const BasicVector<T> &b);           \
+    template BasicRectangles<T> operator+(const BasicVector<T> &a,            \
+                                          BasicRectangles<T> b);              \
+    template bool can_merge_horizontally(                                     \
+            const BasicRectangle<T> &rect1, const BasicRectangle<T> &rect2);  \
+    template bool can_merge_vertically(                                       \
+            const BasicRectangle<T> &rect1, const BasicRectangle<T> &rect2);  \
+    template BasicRectangle<T> merge_horizontally(                            \
+            const BasicRectangle<T> &rect1, const BasicRectangle<T> &rect2);  \
+    template BasicRectangle<T> merge_vertically(                              \
+            const BasicRectangle<T> &rect1, const BasicRectangle<T> &rect2);  \
+    template BasicRectangle<T> merge_all(const BasicRectangles<T> &rects);    \
+    template BasicMergeResult<T> merge_tiling(const BasicRectangles<T> &rects);
+
+GEOMETRY_INSTANTIATE(int16_t)
+GEOMETRY_INSTANTIATE(int)
+GEOMETRY_INSTANTIATE(int64_t)
+
+#undef GEOMETRY_INSTANTIATE
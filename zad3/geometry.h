@@ -1,182 +1,604 @@
 #ifndef GEOMETRY_H
 #define GEOMETRY_H
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-class Vector;
-
-class Position;
-
-class Rectangle;
-
-class Rectangles;
-
-class Position {
+// Typy są szablonami parametryzowanymi typem współrzędnych T. Metody
+// BasicRectangles i operacje merge są skompilowane w geometry.cc dla
+// int16_t, int i int64_t; tylko te typy współrzędnych są obsługiwane.
+
+template <typename T>
+class BasicVector;
+
+template <typename T>
+class BasicPosition;
+
+template <typename T>
+class BasicRectangle;
+
+template <typename T>
+class BasicRectangles;
+
+using Vector = BasicVector<int>;
+using Position = BasicPosition<int>;
+using Rectangle = BasicRectangle<int>;
+using Rectangles = BasicRectangles<int>;
+
+// Wersje o 16-bitowych współrzędnych: prostokąt zajmuje 8 bajtów zamiast 16.
+using Vector16 = BasicVector<int16_t>;
+using Position16 = BasicPosition<int16_t>;
+using Rectangle16 = BasicRectangle<int16_t>;
+using Rectangles16 = BasicRectangles<int16_t>;
+
+using Vector64 = BasicVector<int64_t>;
+using Position64 = BasicPosition<int64_t>;
+using Rectangle64 = BasicRectangle<int64_t>;
+using Rectangles64 = BasicRectangles<int64_t>;
+
+// Zwraca a + b albo zgłasza std::overflow_error, gdy wynik nie mieści się
+// w T. Na szybkiej ścieżce to jedno dodawanie i skok po fladze przepełnienia.
+template <typename T>
+constexpr T checked_add(T a, T b) {
+    T result = 0;
+    if (__builtin_add_overflow(a, b, &result)) {
+        throw std::overflow_error("geometry: integer overflow");
+    }
+    return result;
+}
+
+// friend of BasicRectangle
+template <typename T>
+BasicRectangle<T> merge_all(const BasicRectangles<T> &rects);
+
+template <typename T>
+class BasicPosition {
 private:
-    int x_;
-    int y_;
+    T x_;
+    T y_;
 
 public:
     // konstruktory
-    Position() = delete;
+    BasicPosition() = delete;
 
-    Position(int x, int y);
+    constexpr BasicPosition(T x, T y) noexcept;
 
-    Position(const Position&) = default;
+    constexpr BasicPosition(const BasicPosition&) noexcept = default;
 
-    explicit Position(const Vector &vec);
+    constexpr explicit BasicPosition(const BasicVector<T> &vec) noexcept;
 
     // destruktory
-    ~Position() = default;
+    ~BasicPosition() = default;
 
     // gettery
-    [[nodiscard]] int x() const;
-    [[nodiscard]] int y() const;
+    [[nodiscard]] constexpr T x() const noexcept;
+    [[nodiscard]] constexpr T y() const noexcept;
 
     // metody
-    [[nodiscard]] Position reflection() const;
+    [[nodiscard]] constexpr BasicPosition reflection() const noexcept;
 
-    const static Position origin();
+    constexpr static BasicPosition origin() noexcept;
 
     // operatory
-    Position &operator=(const Position &pos) = default;
+    constexpr BasicPosition &operator=(const BasicPosition &pos) noexcept
+            = default;
 
-    Position &operator=(const Vector &vec) = delete;
+    BasicPosition &operator=(const BasicVector<T> &vec) = delete;
 
-    Position &operator+=(const Vector& vector);
+    // Zgłasza std::overflow_error przy przepełnieniu współrzędnej; wtedy
+    // pozycja pozostaje niezmieniona.
+    constexpr BasicPosition &operator+=(const BasicVector<T>& vector);
 };
 
 
-class Vector {
+template <typename T>
+class BasicVector {
 private:
-    Position coords_;
+    BasicPosition<T> coords_;
 
 public:
     // konstruktory
-    Vector() = delete;
+    BasicVector() = delete;
 
-    Vector(int x, int y);
+    constexpr BasicVector(T x, T y) noexcept;
 
-    Vector(const Vector&) = default;
+    constexpr BasicVector(const BasicVector&) noexcept = default;
 
-    explicit Vector(const Position &pos);
+    constexpr explicit BasicVector(const BasicPosition<T> &pos) noexcept;
 
     // destruktory
-    ~Vector() = default;
+    ~BasicVector() = default;
 
     // gettery
-    [[nodiscard]] int x() const;
-    [[nodiscard]] int y() const;
+    [[nodiscard]] constexpr T x() const noexcept;
+    [[nodiscard]] constexpr T y() const noexcept;
 
     // metody
-    [[nodiscard]] Vector reflection() const;
+    [[nodiscard]] constexpr BasicVector reflection() const noexcept;
 
     // operatory
-    Vector &operator=(const Vector &vec) = default;
+    constexpr BasicVector &operator=(const BasicVector &vec) noexcept
+            = default;
 
-    Vector &operator=(const Position &pos) = delete;
+    BasicVector &operator=(const BasicPosition<T> &pos) = delete;
 
-    Vector &operator+=(const Vector& vector);
+    constexpr BasicVector &operator+=(const BasicVector& vector);
 };
 
 
-class Rectangle {
+template <typename T>
+class BasicRectangle {
 private:
-    Position bottomLeftCorner_;
-    int width_;
-    int height_;
+    BasicPosition<T> bottomLeftCorner_;
+    T width_;
+    T height_;
 
 public:
     // konstruktory
-    Rectangle() = delete;
+    BasicRectangle() = delete;
 
-    Rectangle(int width, int height);
+    constexpr BasicRectangle(T width, T height) noexcept;
 
-    Rectangle(int width, int height, const Position &pos);
+    constexpr BasicRectangle(T width, T height,
+                             const BasicPosition<T> &pos) noexcept;
 
-    Rectangle(const Rectangle&) = default;
+    constexpr BasicRectangle(const BasicRectangle&) noexcept = default;
 
-    Rectangle &operator=(const Rectangle&) = default;
+    constexpr BasicRectangle &operator=(const BasicRectangle&) noexcept
+            = default;
 
     // destruktory
-    ~Rectangle() = default;
+    ~BasicRectangle() = default;
 
     // gettery
-    [[nodiscard]] int width() const;
-    [[nodiscard]] int height() const;
-    [[nodiscard]] Position pos() const;
+    [[nodiscard]] constexpr T width() const noexcept;
+    [[nodiscard]] constexpr T height() const noexcept;
+    [[nodiscard]] constexpr BasicPosition<T> pos() const noexcept;
 
     // metody
-    [[nodiscard]] Rectangle reflection() const;
+    [[nodiscard]] constexpr BasicRectangle reflection() const noexcept;
 
-    [[nodiscard]] int area() const;
+    // Dla współrzędnych 64-bitowych iloczyn może się nie zmieścić
+    // w int64_t; wtedy zgłaszany jest std::overflow_error.
+    [[nodiscard]] constexpr int64_t area() const
+            noexcept(sizeof(T) < sizeof(int64_t));
 
-    friend Rectangle merge_all(const Rectangles &rects);
+    // Przesunięcie bez wyjątku: współrzędne są liczone modulo 2^n, a wynik
+    // mówi, czy nastąpiło przepełnienie. Nie ma w nim skoków, więc pętle
+    // masowe zbierają flagi i sprawdzają je raz, na końcu.
+    constexpr bool wrapping_translate(const BasicVector<T>& vector) noexcept;
+
+    // Odwraca wrapping_translate o ten sam wektor, także po przepełnieniu.
+    constexpr void wrapping_untranslate(const BasicVector<T>& vector) noexcept;
+
+    friend BasicRectangle merge_all<T>(const BasicRectangles<T> &rects);
 
     // operatory
-    Rectangle &operator+=(const Vector& vector);
+    constexpr BasicRectangle &operator+=(const BasicVector<T>& vector);
 };
 
 
-class Rectangles {
+template <typename T>
+class BasicRectangles {
 private:
-    std::vector<Rectangle> rectangles_;
+    std::vector<BasicRectangle<T>> rectangles_;
 
 public:
+    using iterator = typename std::vector<BasicRectangle<T>>::iterator;
+    using const_iterator =
+            typename std::vector<BasicRectangle<T>>::const_iterator;
+
     // konstruktory
-    Rectangles() = default;
+    BasicRectangles() = default;
 
-    Rectangles(std::initializer_list <Rectangle> rect);
+    BasicRectangles(std::initializer_list <BasicRectangle<T>> rect);
 
-    Rectangles(const Rectangles&) = default;
+    explicit BasicRectangles(std::vector<BasicRectangle<T>> rects);
 
-    Rectangles &operator=(const Rectangles&) = default;
+    // Tylko dla iteratorów wejściowych, żeby np. para liczb nie trafiała tutaj.
+    template <typename InputIt,
+              typename = std::enable_if_t<std::is_convertible_v<
+                      typename std::iterator_traits<InputIt>::iterator_category,
+                      std::input_iterator_tag>>>
+    BasicRectangles(InputIt first, InputIt last);
+
+    BasicRectangles(const BasicRectangles&) = default;
+
+    BasicRectangles(BasicRectangles&&) noexcept = default;
+
+    BasicRectangles &operator=(const BasicRectangles&) = default;
+
+    BasicRectangles &operator=(BasicRectangles&&) noexcept = default;
 
     // destruktory
-    ~Rectangles() = default;
+    ~BasicRectangles() = default;
 
     // metody
     [[nodiscard]] size_t size() const;
 
+    void reserve(size_t capacity);
+
+    void push_back(const BasicRectangle<T> &rect);
+
+    template <typename... Args>
+    BasicRectangle<T> &emplace_back(Args&&... args);
+
+    // Dopisuje na końcu prostokąty z rects.
+    BasicRectangles &append(const BasicRectangles &rects);
+
+    BasicRectangles &append(BasicRectangles &&rects);
+
+    [[nodiscard]] BasicRectangles reflection() const;
+
+    // Suma pól wszystkich prostokątów.
+    [[nodiscard]] int64_t area() const;
+
+    // iteratory
+    iterator begin();
+    iterator end();
+    [[nodiscard]] const_iterator begin() const;
+    [[nodiscard]] const_iterator end() const;
+
     // operatory
-    Rectangles &operator+=(const Vector& vector);
+    BasicRectangles &operator+=(const BasicVector<T>& vector);
 
-    const Rectangle &operator[](size_t position) const;
+    const BasicRectangle<T> &operator[](size_t position) const;
 
-    Rectangle &operator[](size_t position);
+    BasicRectangle<T> &operator[](size_t position);
 
-    bool operator==(const Rectangles &rects) const;
+    bool operator==(const BasicRectangles &rects) const;
 };
 
+extern template class BasicRectangles<int16_t>;
+extern template class BasicRectangles<int>;
+extern template class BasicRectangles<int64_t>;
+
 
 // operatory non-member
-bool operator==(const Position &a, const Position &b);
+template <typename T>
+constexpr bool operator==(const BasicPosition<T> &a,
+                          const BasicPosition<T> &b) noexcept;
 
-bool operator==(const Vector &a, const Vector &b);
+template <typename T>
+constexpr bool operator==(const BasicVector<T> &a,
+                          const BasicVector<T> &b) noexcept;
 
-bool operator==(const Rectangle &a, const Rectangle &b);
+template <typename T>
+constexpr bool operator==(const BasicRectangle<T> &a,
+                          const BasicRectangle<T> &b) noexcept;
 
-Position operator+(Position a, const Vector &b);
+template <typename T>
+constexpr BasicPosition<T> operator+(BasicPosition<T> a,
+                                     const BasicVector<T> &b);
 
-Position operator+(const Vector &a, Position b);
+template <typename T>
+constexpr BasicPosition<T> operator+(const BasicVector<T> &a,
+                                     BasicPosition<T> b);
 
-Vector operator+(Vector a, const Vector &b);
+template <typename T>
+constexpr BasicVector<T> operator+(BasicVector<T> a, const BasicVector<T> &b);
 
-Rectangle operator+(Rectangle a, const Vector &b);
+template <typename T>
+constexpr BasicRectangle<T> operator+(BasicRectangle<T> a,
+                                      const BasicVector<T> &b);
 
-Rectangle operator+(const Vector &a, Rectangle b);
+template <typename T>
+constexpr BasicRectangle<T> operator+(const BasicVector<T> &a,
+                                      BasicRectangle<T> b);
 
-Rectangles operator+(Rectangles a, const Vector &b);
+template <typename T>
+BasicRectangles<T> operator+(BasicRectangles<T> a, const BasicVector<T> &b);
 
-Rectangles operator+(const Vector &a, Rectangles b);
+template <typename T>
+BasicRectangles<T> operator+(const BasicVector<T> &a, BasicRectangles<T> b);
 
 
 // operacje merge
-Rectangle merge_horizontally(const Rectangle &rect1, const Rectangle &rect2);
+// Czy rect2 leży bezpośrednio nad rect1 i ma tę samą szerokość.
+template <typename T>
+bool can_merge_horizontally(const BasicRectangle<T> &rect1,
+                            const BasicRectangle<T> &rect2);
+
+// Czy rect2 leży bezpośrednio na prawo od rect1 i ma tę samą wysokość.
+template <typename T>
+bool can_merge_vertically(const BasicRectangle<T> &rect1,
+                          const BasicRectangle<T> &rect2);
+
+// Przy przepełnieniu wymiaru wyniku zgłaszają std::overflow_error.
+template <typename T>
+BasicRectangle<T> merge_horizontally(const BasicRectangle<T> &rect1,
+                                     const BasicRectangle<T> &rect2);
+
+template <typename T>
+BasicRectangle<T> merge_vertically(const BasicRectangle<T> &rect1,
+                                   const BasicRectangle<T> &rect2);
+
+enum class MergeStatus {
+    success,
+    empty,     // brak prostokątów
+    gap,       // prostokąty nie pokrywają całego prostokąta ograniczającego
+    overlap,   // wnętrza pewnych prostokątów mają część wspólną
+    too_large  // wynik nie mieści się w zakresie typu współrzędnych
+};
+
+template <typename T>
+struct BasicMergeResult {
+    MergeStatus status;
+    std::optional<BasicRectangle<T>> rectangle;  // ustawiony wtedy i tylko
+                                                 // wtedy, gdy
+                                                 // status == success
+};
+
+using MergeResult = BasicMergeResult<int>;
+
+// Scala prostokąty podane w dowolnej kolejności, jeśli razem dokładnie
+// (bez dziur i nakładania się) pokrywają pewien prostokąt. Działa
+// w czasie O(n log n).
+template <typename T>
+BasicMergeResult<T> merge_tiling(const BasicRectangles<T> &rects);
+
+// Przeciążenia dla int przyjmują też listę inicjalizacyjną, np.
+// merge_all({rect1, rect2}), której szablon nie potrafi wydedukować.
+inline Rectangle merge_all(const Rectangles &rects) {
+    return merge_all<int>(rects);
+}
+
+inline MergeResult merge_tiling(const Rectangles &rects) {
+    return merge_tiling<int>(rects);
+}
+
+
+// Definicje metod typów wartościowych są w nagłówku, żeby mogły być
+// constexpr i rozwijane w miejscu wywołania.
+
+// BasicPosition
+
+// konstruktory
+template <typename T>
+constexpr BasicPosition<T>::BasicPosition(T x, T y) noexcept
+        : x_(x), y_(y) {}
+
+template <typename T>
+constexpr BasicPosition<T>::BasicPosition(const BasicVector<T> &vec) noexcept
+        : x_(vec.x()), y_(vec.y()) {}
+
+// gettery
+template <typename T>
+constexpr T BasicPosition<T>::x() const noexcept {
+    return x_;
+}
+
+template <typename T>
+constexpr T BasicPosition<T>::y() const noexcept {
+    return y_;
+}
+
+// metody
+template <typename T>
+constexpr BasicPosition<T> BasicPosition<T>::reflection() const noexcept {
+    return BasicPosition(y_, x_);
+}
+
+template <typename T>
+constexpr BasicPosition<T> BasicPosition<T>::origin() noexcept {
+    return BasicPosition(0, 0);
+}
+
+// operatory
+template <typename T>
+constexpr BasicPosition<T> &BasicPosition<T>::operator+=(
+        const BasicVector<T> &vector) {
+    T x = checked_add(x_, vector.x());
+    y_ = checked_add(y_, vector.y());
+    x_ = x;
+    return *this;
+}
+
+
+// BasicVector
+
+// konstruktory
+template <typename T>
+constexpr BasicVector<T>::BasicVector(T x, T y) noexcept : coords_(x, y) {}
+
+template <typename T>
+constexpr BasicVector<T>::BasicVector(const BasicPosition<T> &pos) noexcept
+        : coords_(pos.x(), pos.y()) {}
+
+// gettery
+template <typename T>
+constexpr T BasicVector<T>::x() const noexcept {
+    return coords_.x();
+}
+
+template <typename T>
+constexpr T BasicVector<T>::y() const noexcept {
+    return coords_.y();
+}
+
+// metody
+template <typename T>
+constexpr BasicVector<T> BasicVector<T>::reflection() const noexcept {
+    return BasicVector(coords_.reflection());
+}
+
+// operatory
+template <typename T>
+constexpr BasicVector<T> &BasicVector<T>::operator+=(
+        const BasicVector &vector) {
+    coords_ += vector;
+    return *this;
+}
+
+
+// BasicRectangle
+
+// konstruktory
+template <typename T>
+constexpr BasicRectangle<T>::BasicRectangle(
+        T width, T height, const BasicPosition<T> &pos) noexcept
+        : bottomLeftCorner_(pos), width_(width), height_(height) {
+    assert(width > 0 && height > 0);
+}
+
+template <typename T>
+constexpr BasicRectangle<T>::BasicRectangle(T width, T height) noexcept
+        : bottomLeftCorner_(BasicPosition<T>::origin()), width_(width),
+          height_(height) {
+    assert(width > 0 && height > 0);
+}
+
+// gettery
+template <typename T>
+constexpr T BasicRectangle<T>::width() const noexcept {
+    return width_;
+}
+
+template <typename T>
+constexpr T BasicRectangle<T>::height() const noexcept {
+    return height_;
+}
+
+template <typename T>
+constexpr BasicPosition<T> BasicRectangle<T>::pos() const noexcept {
+    return bottomLeftCorner_;
+}
+
+// metody
+template <typename T>
+constexpr BasicRectangle<T> BasicRectangle<T>::reflection() const noexcept {
+    return BasicRectangle(height_, width_, bottomLeftCorner_.reflection());
+}
+
+template <typename T>
+constexpr int64_t BasicRectangle<T>::area() const
+        noexcept(sizeof(T) < sizeof(int64_t)) {
+    if constexpr (sizeof(T) < sizeof(int64_t)) {
+        return static_cast<int64_t>(width_) * height_;
+    } else {
+        int64_t result = 0;
+        if (__builtin_mul_overflow(width_, height_, &result)) {
+            throw std::overflow_error("geometry: area overflow");
+        }
+        return result;
+    }
+}
+
+template <typename T>
+constexpr bool BasicRectangle<T>::wrapping_translate(
+        const BasicVector<T> &vector) noexcept {
+    T x = 0;
+    T y = 0;
+    bool overflow_x = __builtin_add_overflow(bottomLeftCorner_.x(), vector.x(), &x);
+    bool overflow_y = __builtin_add_overflow(bottomLeftCorner_.y(), vector.y(), &y);
+    bottomLeftCorner_ = BasicPosition<T>(x, y);
+    return overflow_x | overflow_y;
+}
+
+template <typename T>
+constexpr void BasicRectangle<T>::wrapping_untranslate(
+        const BasicVector<T> &vector) noexcept {
+    T x = 0;
+    T y = 0;
+    __builtin_sub_overflow(bottomLeftCorner_.x(), vector.x(), &x);
+    __builtin_sub_overflow(bottomLeftCorner_.y(), vector.y(), &y);
+    bottomLeftCorner_ = BasicPosition<T>(x, y);
+}
+
+// operatory
+template <typename T>
+constexpr BasicRectangle<T> &BasicRectangle<T>::operator+=(
+        const BasicVector<T> &vector) {
+    bottomLeftCorner_ += vector;
+    return *this;
+}
+
+
+// Układ w pamięci: bez wypełnienia, prostokąt to dokładnie cztery
+// współrzędne, a wszystkie typy wartościowe można kopiować jak bajty.
+template <typename T>
+constexpr bool has_packed_layout =
+        std::is_trivially_copyable_v<BasicPosition<T>> &&
+        std::is_trivially_copyable_v<BasicVector<T>> &&
+        std::is_trivially_copyable_v<BasicRectangle<T>> &&
+        sizeof(BasicPosition<T>) == 2 * sizeof(T) &&
+        sizeof(BasicVector<T>) == 2 * sizeof(T) &&
+        sizeof(BasicRectangle<T>) == 4 * sizeof(T);
+
+static_assert(has_packed_layout<int16_t>);
+static_assert(has_packed_layout<int>);
+static_assert(has_packed_layout<int64_t>);
 
-Rectangle merge_vertically(const Rectangle &rect1, const Rectangle &rect2);
 
-// friend of Rectangle
-Rectangle merge_all(const Rectangles &rects);
+// operatory non-member
+template <typename T>
+constexpr bool operator==(const BasicPosition<T> &a,
+                          const BasicPosition<T> &b) noexcept {
+    return a.x() == b.x() && a.y() == b.y();
+}
+
+template <typename T>
+constexpr bool operator==(const BasicVector<T> &a,
+                          const BasicVector<T> &b) noexcept {
+    return a.x() == b.x() && a.y() == b.y();
+}
+
+template <typename T>
+constexpr bool operator==(const BasicRectangle<T> &a,
+                          const BasicRectangle<T> &b) noexcept {
+    return a.pos() == b.pos() && a.width() == b.width() &&
+           a.height() == b.height();
+}
+
+template <typename T>
+constexpr BasicPosition<T> operator+(BasicPosition<T> a,
+                                     const BasicVector<T> &b) {
+    return a += b;
+}
+
+template <typename T>
+constexpr BasicPosition<T> operator+(const BasicVector<T> &a,
+                                     BasicPosition<T> b) {
+    return b += a;
+}
+
+template <typename T>
+constexpr BasicVector<T> operator+(BasicVector<T> a,
+                                   const BasicVector<T> &b) {
+    return a += b;
+}
+
+template <typename T>
+constexpr BasicRectangle<T> operator+(BasicRectangle<T> a,
+                                      const BasicVector<T> &b) {
+    return a += b;
+}
+
+template <typename T>
+constexpr BasicRectangle<T> operator+(const BasicVector<T> &a,
+                                      BasicRectangle<T> b) {
+    return b += a;
+}
+
+
+// BasicRectangles - szablony
+template <typename T>
+template <typename InputIt, typename>
+BasicRectangles<T>::BasicRectangles(InputIt first, InputIt last)
+        : rectangles_(first, last) {}
+
+template <typename T>
+template <typename... Args>
+BasicRectangle<T> &BasicRectangles<T>::emplace_back(Args&&... args) {
+    return rectangles_.emplace_back(std::forward<Args>(args)...);
+}
 
 #endif // GEOMETRY_H
@@ -0,0 +1,100 @@
+#ifndef GEOMETRY_PARALLEL_H
+#define GEOMETRY_PARALLEL_H
+
+#include "geometry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Operacje masowe na Rectangles wykonywane zgodnie z polityką wykonania
+// (std::execution::seq, par, par_unseq). Są w osobnym nagłówku, bo
+// w libstdc++ polityki równoległe wymagają linkowania z TBB (-ltbb).
+// Wyjątek zgłoszony wewnątrz algorytmu z polityką kończy program przez
+// std::terminate, dlatego przepełnienie jest wykrywane bez wyjątków w pętli,
+// a std::overflow_error zgłaszamy dopiero po niej, jak wersje sekwencyjne.
+
+// Ogranicza przeciążenia do typów, które rzeczywiście są polityką.
+template <typename ExecutionPolicy>
+using enable_if_execution_policy_t = std::enable_if_t<
+        std::is_execution_policy_v<std::decay_t<ExecutionPolicy>>, int>;
+
+// Odpowiednik rects += vector: przy przepełnieniu kolekcja się nie zmienia.
+template <typename ExecutionPolicy, typename T,
+          enable_if_execution_policy_t<ExecutionPolicy> = 0>
+BasicRectangles<T> &translate(ExecutionPolicy &&policy,
+                              BasicRectangles<T> &rects,
+                              const BasicVector<T> &vector) {
+    // Zapis relaksowany niczego nie synchronizuje, więc wolno go użyć
+    // także z polityką par_unseq.
+    std::atomic<bool> overflow(false);
+    std::for_each(policy, rects.begin(), rects.end(),
+                  [vector, &overflow](BasicRectangle<T> &rect) {
+                      if (rect.wrapping_translate(vector)) {
+                          overflow.store(true, std::memory_order_relaxed);
+                      }
+                  });
+    if (overflow.load(std::memory_order_relaxed)) {
+        std::for_each(std::forward<ExecutionPolicy>(policy), rects.begin(),
+                      rects.end(), [vector](BasicRectangle<T> &rect) {
+                          rect.wrapping_untranslate(vector);
+                      });
+        throw std::overflow_error("geometry: integer overflow");
+    }
+    return rects;
+}
+
+// Odpowiednik rects.reflection().
+template <typename ExecutionPolicy, typename T,
+          enable_if_execution_policy_t<ExecutionPolicy> = 0>
+BasicRectangles<T> reflection(ExecutionPolicy &&policy,
+                              const BasicRectangles<T> &rects) {
+    BasicRectangles<T> result(rects);
+    std::for_each(std::forward<ExecutionPolicy>(policy), result.begin(),
+                  result.end(),
+                  [](BasicRectangle<T> &rect) { rect = rect.reflection(); });
+    return result;
+}
+
+// Pole prostokąta bez wyjątku. Pole, które nie mieści się w int64_t, daje
+// INT64_MAX + 1, więc i suma przekroczy INT64_MAX. Składniki nie
+// przekraczają 2^63, zatem suma mniej niż 2^64 z nich mieści się w __int128.
+template <typename T>
+__int128 wide_area(const BasicRectangle<T> &rect) noexcept {
+    int64_t result = 0;
+    if (__builtin_mul_overflow(rect.width(), rect.height(), &result)) {
+        return __int128(std::numeric_limits<int64_t>::max()) + 1;
+    }
+    return result;
+}
+
+// Odpowiednik rects.area(): przy przepełnieniu zgłasza std::overflow_error.
+template <typename ExecutionPolicy, typename T,
+          enable_if_execution_policy_t<ExecutionPolicy> = 0>
+int64_t area(ExecutionPolicy &&policy, const BasicRectangles<T> &rects) {
+    __int128 result = std::transform_reduce(
+            std::forward<ExecutionPolicy>(policy), rects.begin(), rects.end(),
+            __int128(0), std::plus<>(), wide_area<T>);
+    if (result > std::numeric_limits<int64_t>::max()) {
+        throw std::overflow_error("geometry: area overflow");
+    }
+    return int64_t(result);
+}
+
+// Odpowiednik a == b; porównanie kończy się przy pierwszej różnicy.
+template <typename ExecutionPolicy, typename T,
+          enable_if_execution_policy_t<ExecutionPolicy> = 0>
+bool equal(ExecutionPolicy &&policy, const BasicRectangles<T> &a,
+           const BasicRectangles<T> &b) {
+    return a.size() == b.size() &&
+           std::equal(std::forward<ExecutionPolicy>(policy), a.begin(),
+                      a.end(), b.begin());
+}
+
+#endif // GEOMETRY_PARALLEL_H
@@ -0,0 +1,127 @@
+#include "rectangles_soa.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    // Dodaje delta do każdego elementu tablicy modulo 2^32 i zwraca, czy
+    // któreś dodawanie się przepełniło. Wskaźnik __restrict__ i brak
+    // rozgałęzień pozwalają kompilatorowi zwektoryzować pętlę.
+    bool wrapping_add_to_all(int *__restrict__ values, size_t count,
+                             int delta) {
+        bool overflow = false;
+        for (size_t i = 0; i < count; ++i) {
+            overflow |= __builtin_add_overflow(values[i], delta, &values[i]);
+        }
+        return overflow;
+    }
+
+    // Odwraca wrapping_add_to_all o tę samą deltę.
+    void wrapping_sub_from_all(int *__restrict__ values, size_t count,
+                               int delta) {
+        for (size_t i = 0; i < count; ++i) {
+            __builtin_sub_overflow(values[i], delta, &values[i]);
+        }
+    }
+}
+
+// konstruktory
+RectanglesSoA::RectanglesSoA(const Rectangles &rects) {
+    reserve(rects.size());
+    for (size_t i = 0; i < rects.size(); ++i) {
+        push_back(rects[i]);
+    }
+}
+
+// metody
+size_t RectanglesSoA::size() const {
+    return x_.size();
+}
+
+void RectanglesSoA::reserve(size_t capacity) {
+    x_.reserve(capacity);
+    y_.reserve(capacity);
+    width_.reserve(capacity);
+    height_.reserve(capacity);
+}
+
+void RectanglesSoA::push_back(const Rectangle &rect) {
+    x_.push_back(rect.pos().x());
+    y_.push_back(rect.pos().y());
+    width_.push_back(rect.width());
+    height_.push_back(rect.height());
+}
+
+void RectanglesSoA::reflect() {
+    // Odbicie zamienia współrzędne x z y oraz szerokość z wysokością, więc
+    // wystarczy zamienić całe tablice.
+    x_.swap(y_);
+    width_.swap(height_);
+}
+
+RectanglesSoA RectanglesSoA::reflection() const {
+    RectanglesSoA result(*this);
+    result.reflect();
+    return result;
+}
+
+int64_t RectanglesSoA::area_sum() const {
+    const int *__restrict__ width = width_.data();
+    const int *__restrict__ height = height_.data();
+    // Iloczyny mieszczą się w int64_t, przepełnić może się tylko suma.
+    int64_t sum = 0;
+    bool overflow = false;
+    for (size_t i = 0; i < size(); ++i) {
+        overflow |= __builtin_add_overflow(
+                sum, static_cast<int64_t>(width[i]) * height[i], &sum);
+    }
+    if (overflow) {
+        throw std::overflow_error("geometry: area overflow");
+    }
+    return sum;
+}
+
+Rectangles RectanglesSoA::to_rectangles() const {
+    std::vector<Rectangle> rects;
+    rects.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        rects.emplace_back(width_[i], height_[i], Position(x_[i], y_[i]));
+    }
+    return Rectangles(std::move(rects));
+}
+
+// operatory
+RectanglesSoA &RectanglesSoA::operator+=(const Vector &vector) {
+    // Flagi przepełnienia sprawdzamy raz, po pętlach; przy błędzie cofamy
+    // przesunięcie, żeby kolekcja się nie zmieniła.
+    bool overflow = wrapping_add_to_all(x_.data(), size(), vector.x());
+    overflow |= wrapping_add_to_all(y_.data(), size(), vector.y());
+    if (overflow) {
+        wrapping_sub_from_all(x_.data(), size(), vector.x());
+        wrapping_sub_from_all(y_.data(), size(), vector.y());
+        throw std::overflow_error("geometry: integer overflow");
+    }
+    return *this;
+}
+
+Rectangle RectanglesSoA::operator[](size_t position) const {
+    assert(position < size());
+    return Rectangle(width_[position], height_[position],
+                     Position(x_[position], y_[position]));
+}
+
+bool RectanglesSoA::operator==(const RectanglesSoA &rects) const {
+    return x_ == rects.x_ && y_ == rects.y_ && width_ == rects.width_ &&
+           height_ == rects.height_;
+}
+
+
+// operatory non-member
+RectanglesSoA operator+(RectanglesSoA a, const Vector &b) {
+    return a += b;
+}
+
+RectanglesSoA operator+(const Vector &a, RectanglesSoA b) {
+    return b += a;
+}
@@ -0,0 +1,55 @@
+#ifndef RECTANGLES_SOA_H
+#define RECTANGLES_SOA_H
+
+#include "geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Kolekcja prostokątów w układzie struktury tablic: współrzędne i wymiary
+// trzymane są w osobnych, ciągłych tablicach, dzięki czemu operacje
+// masowe są prostymi pętlami, które kompilator wektoryzuje.
+class RectanglesSoA {
+private:
+    std::vector<int> x_;
+    std::vector<int> y_;
+    std::vector<int> width_;
+    std::vector<int> height_;
+
+public:
+    // konstruktory
+    RectanglesSoA() = default;
+
+    explicit RectanglesSoA(const Rectangles &rects);
+
+    // metody
+    [[nodiscard]] size_t size() const;
+
+    void reserve(size_t capacity);
+
+    void push_back(const Rectangle &rect);
+
+    // Odbija wszystkie prostokąty względem prostej y = x w czasie O(1).
+    void reflect();
+
+    [[nodiscard]] RectanglesSoA reflection() const;
+
+    // Suma pól wszystkich prostokątów.
+    [[nodiscard]] int64_t area_sum() const;
+
+    [[nodiscard]] Rectangles to_rectangles() const;
+
+    // operatory
+    RectanglesSoA &operator+=(const Vector &vector);
+
+    Rectangle operator[](size_t position) const;
+
+    bool operator==(const RectanglesSoA &rects) const;
+};
+
+RectanglesSoA operator+(RectanglesSoA a, const Vector &b);
+
+RectanglesSoA operator+(const Vector &a, RectanglesSoA b);
+
+#endif // RECTANGLES_SOA_H
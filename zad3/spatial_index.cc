@@ -0,0 +1,285 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+namespace {
+    // Porządkuje [order] metodą Sort-Tile-Recursive tak, żeby kolejne grupy
+    // po [capacity] elementów tworzyły zwarte kafelki: najpierw według
+    // środka w osi x w pionowe pasy, a w każdym pasie według środka w osi y.
+    template <typename Center>
+    void str_order(std::vector<size_t> &order, size_t capacity,
+                   Center center) {
+        size_t groups = (order.size() + capacity - 1) / capacity;
+        auto slices = static_cast<size_t>(
+                std::ceil(std::sqrt(static_cast<double>(groups))));
+        size_t slice_size = slices * capacity;
+
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return center(a).first < center(b).first;
+        });
+        for (size_t begin = 0; begin < order.size(); begin += slice_size) {
+            size_t end = std::min(order.size(), begin + slice_size);
+            std::sort(order.begin() + begin, order.begin() + end,
+                      [&](size_t a, size_t b) {
+                          return center(a).second < center(b).second;
+                      });
+        }
+    }
+
+    bool intersects(int64_t a_min, int64_t a_max, int64_t b_min,
+                    int64_t b_max) {
+        return a_min <= b_max && b_min <= a_max;
+    }
+
+    double axis_distance(int64_t value, int64_t min, int64_t max) {
+        if (value < min) {
+            return static_cast<double>(min - value);
+        } else if (value > max) {
+            return static_cast<double>(value - max);
+        } else {
+            return 0;
+        }
+    }
+}
+
+// konstruktory
+IndexedRectangles::IndexedRectangles(const Rectangles &rects) {
+    rectangles_.reserve(rects.size());
+    for (size_t i = 0; i < rects.size(); ++i) {
+        rectangles_.push_back(rects[i]);
+    }
+    if (rectangles_.empty()) {
+        return;
+    }
+
+    corners_ = Box{rectangles_[0].pos().x(), rectangles_[0].pos().y(),
+                   rectangles_[0].pos().x(), rectangles_[0].pos().y()};
+    for (const Rectangle &rect : rectangles_) {
+        corners_.min_x = std::min<int64_t>(corners_.min_x, rect.pos().x());
+        corners_.min_y = std::min<int64_t>(corners_.min_y, rect.pos().y());
+        corners_.max_x = std::max<int64_t>(corners_.max_x, rect.pos().x());
+        corners_.max_y = std::max<int64_t>(corners_.max_y, rect.pos().y());
+    }
+
+    // Liście: prostokąty w kolejności STR.
+    ids_.resize(rectangles_.size());
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        ids_[i] = i;
+    }
+    std::vector<Box> boxes(rectangles_.size());
+    for (size_t i = 0; i < rectangles_.size(); ++i) {
+        boxes[i] = box_of(rectangles_[i]);
+    }
+    auto box_center = [](const Box &box) {
+        return std::make_pair(box.min_x + box.max_x, box.min_y + box.max_y);
+    };
+    str_order(ids_, node_capacity,
+              [&](size_t i) { return box_center(boxes[i]); });
+    boxes_.reserve(ids_.size());
+    for (size_t id : ids_) {
+        boxes_.push_back(boxes[id]);
+    }
+
+    // Kolejne poziomy: grupy po node_capacity elementów poziomu niżej.
+    std::vector<Box> children = boxes_;
+    do {
+        std::vector<Node> level;
+        for (size_t first = 0; first < children.size();
+             first += node_capacity) {
+            size_t count = std::min(node_capacity, children.size() - first);
+            Box box = children[first];
+            for (size_t i = first + 1; i < first + count; ++i) {
+                box.min_x = std::min(box.min_x, children[i].min_x);
+                box.min_y = std::min(box.min_y, children[i].min_y);
+                box.max_x = std::max(box.max_x, children[i].max_x);
+                box.max_y = std::max(box.max_y, children[i].max_y);
+            }
+            level.push_back(Node{box, first, count});
+        }
+
+        // Węzły następnego poziomu też są grupowane metodą STR, więc
+        // porządkujemy węzły tego poziomu (razem z ich zakresami dzieci).
+        if (level.size() > 1) {
+            std::vector<size_t> order(level.size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                order[i] = i;
+            }
+            str_order(order, node_capacity,
+                      [&](size_t i) { return box_center(level[i].box); });
+            std::vector<Node> ordered;
+            ordered.reserve(level.size());
+            for (size_t i : order) {
+                ordered.push_back(level[i]);
+            }
+            level = std::move(ordered);
+        }
+
+        children.clear();
+        for (const Node &node : level) {
+            children.push_back(node.box);
+        }
+        levels_.push_back(std::move(level));
+    } while (children.size() > 1);
+}
+
+// metody
+IndexedRectangles::Box IndexedRectangles::box_of(const Rectangle &rect) {
+    return Box{rect.pos().x(), rect.pos().y(),
+               static_cast<int64_t>(rect.pos().x()) + rect.width(),
+               static_cast<int64_t>(rect.pos().y()) + rect.height()};
+}
+
+// Wywołuje on_entry(indeks w rectangles_, Box) dla każdego prostokąta,
+// którego domknięty obszar przecina domknięty obszar query (we
+// współrzędnych bez przesunięcia).
+template <typename F>
+void IndexedRectangles::visit(const Box &query, F on_entry) const {
+    if (levels_.empty()) {
+        return;
+    }
+
+    std::vector<std::pair<size_t, size_t>> stack;  // (poziom, węzeł)
+    stack.emplace_back(levels_.size() - 1, 0);
+    while (!stack.empty()) {
+        auto [level, index] = stack.back();
+        stack.pop_back();
+
+        const Node &node = levels_[level][index];
+        if (!intersects(node.box.min_x, node.box.max_x, query.min_x,
+                        query.max_x) ||
+            !intersects(node.box.min_y, node.box.max_y, query.min_y,
+                        query.max_y)) {
+            continue;
+        }
+
+        for (size_t child = node.first; child < node.first + node.count;
+             ++child) {
+            if (level > 0) {
+                stack.emplace_back(level - 1, child);
+            } else {
+                const Box &box = boxes_[child];
+                if (intersects(box.min_x, box.max_x, query.min_x,
+                               query.max_x) &&
+                    intersects(box.min_y, box.max_y, query.min_y,
+                               query.max_y)) {
+                    on_entry(ids_[child], box);
+                }
+            }
+        }
+    }
+}
+
+size_t IndexedRectangles::size() const {
+    return rectangles_.size();
+}
+
+std::vector<size_t> IndexedRectangles::containing(const Position &point) const {
+    int64_t x = point.x() - offset_x_;
+    int64_t y = point.y() - offset_y_;
+
+    std::vector<size_t> result;
+    visit(Box{x, y, x, y}, [&](size_t id, const Box &) {
+        result.push_back(id);
+    });
+    return result;
+}
+
+std::vector<size_t> IndexedRectangles::overlapping(const Rectangle &rect) const {
+    Box query = box_of(rect);
+    query.min_x -= offset_x_;
+    query.max_x -= offset_x_;
+    query.min_y -= offset_y_;
+    query.max_y -= offset_y_;
+
+    // visit znajduje prostokąty o przecinających się domknięciach; tu
+    // odrzucamy te, które tylko się stykają.
+    std::vector<size_t> result;
+    visit(query, [&](size_t id, const Box &box) {
+        if (box.min_x < query.max_x && query.min_x < box.max_x &&
+            box.min_y < query.max_y && query.min_y < box.max_y) {
+            result.push_back(id);
+        }
+    });
+    return result;
+}
+
+std::optional<size_t> IndexedRectangles::nearest(const Position &point) const {
+    if (levels_.empty()) {
+        return std::nullopt;
+    }
+
+    int64_t x = point.x() - offset_x_;
+    int64_t y = point.y() - offset_y_;
+    auto distance = [&](const Box &box) {
+        return std::hypot(axis_distance(x, box.min_x, box.max_x),
+                          axis_distance(y, box.min_y, box.max_y));
+    };
+
+    // Przeszukiwanie best-first: węzły i prostokąty w kolejności odległości
+    // od punktu. Poziom -1 oznacza prostokąt (indeks w boxes_).
+    struct Candidate {
+        double distance;
+        int level;
+        size_t index;
+
+        bool operator>(const Candidate &other) const {
+            return distance > other.distance;
+        }
+    };
+    std::priority_queue<Candidate, std::vector<Candidate>,
+                        std::greater<Candidate>> queue;
+    int root_level = static_cast<int>(levels_.size()) - 1;
+    queue.push(Candidate{distance(levels_.back()[0].box), root_level, 0});
+
+    while (!queue.empty()) {
+        Candidate candidate = queue.top();
+        queue.pop();
+        if (candidate.level < 0) {
+            return ids_[candidate.index];
+        }
+
+        const Node &node = levels_[candidate.level][candidate.index];
+        for (size_t child = node.first; child < node.first + node.count;
+             ++child) {
+            if (candidate.level > 0) {
+                queue.push(Candidate{
+                        distance(levels_[candidate.level - 1][child].box),
+                        candidate.level - 1, child});
+            } else {
+                queue.push(Candidate{distance(boxes_[child]), -1, child});
+            }
+        }
+    }
+
+    assert(false);
+    return std::nullopt;
+}
+
+// operatory
+IndexedRectangles &IndexedRectangles::operator+=(const Vector &vector) {
+    int64_t offset_x = checked_add<int64_t>(offset_x_, vector.x());
+    int64_t offset_y = checked_add<int64_t>(offset_y_, vector.y());
+    if (!rectangles_.empty() &&
+        (corners_.min_x + offset_x < std::numeric_limits<int>::min() ||
+         corners_.max_x + offset_x > std::numeric_limits<int>::max() ||
+         corners_.min_y + offset_y < std::numeric_limits<int>::min() ||
+         corners_.max_y + offset_y > std::numeric_limits<int>::max())) {
+        throw std::overflow_error("geometry: integer overflow");
+    }
+    offset_x_ = offset_x;
+    offset_y_ = offset_y;
+    return *this;
+}
+
+Rectangle IndexedRectangles::operator[](size_t position) const {
+    assert(position < size());
+    const Rectangle &rect = rectangles_[position];
+    return Rectangle(rect.width(), rect.height(),
+                     Position(static_cast<int>(rect.pos().x() + offset_x_),
+                              static_cast<int>(rect.pos().y() + offset_y_)));
+}
@@ -0,0 +1,78 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include "geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Kolekcja prostokątów z indeksem przestrzennym (R-drzewo budowane metodą
+// Sort-Tile-Recursive). Prostokąt zajmuje domknięty obszar
+// [x, x + width] x [y, y + height]. Przesunięcie całej kolekcji zmienia tylko
+// globalny wektor przesunięcia, bez dotykania prostokątów i indeksu.
+class IndexedRectangles {
+private:
+    struct Box {
+        int64_t min_x;
+        int64_t min_y;
+        int64_t max_x;
+        int64_t max_y;
+    };
+
+    // Węzeł drzewa; jego dzieci to elementy [first, first + count) poziomu
+    // niżej (dla liści: elementy boxes_ i ids_).
+    struct Node {
+        Box box;
+        size_t first;
+        size_t count;
+    };
+
+    static constexpr size_t node_capacity = 16;
+
+    std::vector<Rectangle> rectangles_;
+    // Prostokąty w kolejności liści drzewa i ich indeksy w rectangles_.
+    std::vector<Box> boxes_;
+    std::vector<size_t> ids_;
+    // levels_[0] to liście, levels_.back() zawiera tylko korzeń.
+    std::vector<std::vector<Node>> levels_;
+    int64_t offset_x_ = 0;
+    int64_t offset_y_ = 0;
+    // Zakres lewych dolnych rogów (bez przesunięcia); operator+= sprawdza
+    // na nim, czy współrzędne wszystkich prostokątów mieszczą się w int.
+    Box corners_{};
+
+    static Box box_of(const Rectangle &rect);
+
+    template <typename F>
+    void visit(const Box &query, F on_entry) const;
+
+public:
+    // konstruktory
+    IndexedRectangles() = default;
+
+    explicit IndexedRectangles(const Rectangles &rects);
+
+    // metody
+    [[nodiscard]] size_t size() const;
+
+    // Indeksy (zgodne z operator[]) prostokątów zawierających punkt.
+    [[nodiscard]] std::vector<size_t> containing(const Position &point) const;
+
+    // Indeksy prostokątów, których wnętrza mają część wspólną z wnętrzem rect.
+    [[nodiscard]] std::vector<size_t> overlapping(const Rectangle &rect) const;
+
+    // Indeks prostokąta najbliższego punktowi (w metryce euklidesowej),
+    // brak wartości dla pustej kolekcji.
+    [[nodiscard]] std::optional<size_t> nearest(const Position &point) const;
+
+    // operatory
+    // Zgłasza std::overflow_error (nie zmieniając kolekcji), jeśli
+    // współrzędne któregoś prostokąta nie zmieściłyby się w int.
+    IndexedRectangles &operator+=(const Vector &vector);
+
+    Rectangle operator[](size_t position) const;
+};
+
+#endif // SPATIAL_INDEX_H
@@ -0,0 +1,132 @@
+#include "streaming_merger.h"
+
+#include <cassert>
+#include <functional>
+
+// Edge
+bool StreamingMerger::Edge::operator==(const Edge &other) const {
+    return start == other.start && line == other.line &&
+           length == other.length;
+}
+
+size_t StreamingMerger::EdgeHash::operator()(const Edge &edge) const {
+    std::hash<int64_t> hash;
+    size_t result = hash(edge.start);
+    result = result * 31 + hash(edge.line);
+    result = result * 31 + hash(edge.length);
+    return result;
+}
+
+StreamingMerger::Edge StreamingMerger::bottom_edge(const Rectangle &rect) {
+    return Edge{rect.pos().x(), rect.pos().y(), rect.width()};
+}
+
+StreamingMerger::Edge StreamingMerger::top_edge(const Rectangle &rect) {
+    return Edge{rect.pos().x(),
+                static_cast<int64_t>(rect.pos().y()) + rect.height(),
+                rect.width()};
+}
+
+StreamingMerger::Edge StreamingMerger::left_edge(const Rectangle &rect) {
+    return Edge{rect.pos().y(), rect.pos().x(), rect.height()};
+}
+
+StreamingMerger::Edge StreamingMerger::right_edge(const Rectangle &rect) {
+    return Edge{rect.pos().y(),
+                static_cast<int64_t>(rect.pos().x()) + rect.width(),
+                rect.height()};
+}
+
+// metody
+void StreamingMerger::add(const Rectangle &rect) {
+    size_t slot;
+    if (free_slots_.empty()) {
+        slot = slots_.size();
+        slots_.emplace_back(rect);
+    } else {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        slots_[slot] = rect;
+    }
+    ++size_;
+
+    // Przy rozłącznych wnętrzach żadne dwa prostokąty nie mają tej samej
+    // krawędzi po tej samej stronie.
+    bool inserted = bottom_edges_.emplace(bottom_edge(rect), slot).second;
+    inserted &= top_edges_.emplace(top_edge(rect), slot).second;
+    inserted &= left_edges_.emplace(left_edge(rect), slot).second;
+    inserted &= right_edges_.emplace(right_edge(rect), slot).second;
+    assert(inserted);
+    (void) inserted;
+}
+
+void StreamingMerger::remove(size_t slot) {
+    const Rectangle &rect = *slots_[slot];
+    bottom_edges_.erase(bottom_edge(rect));
+    top_edges_.erase(top_edge(rect));
+    left_edges_.erase(left_edge(rect));
+    right_edges_.erase(right_edge(rect));
+
+    slots_[slot].reset();
+    free_slots_.push_back(slot);
+    --size_;
+}
+
+void StreamingMerger::insert(const Rectangle &rect) {
+    // Najpierw liczymy całą kaskadę scaleń, nie zmieniając zbioru:
+    // merge_* może zgłosić wyjątek przepełnienia na dowolnym kroku.
+    // Wchłonięty sąsiad leży wewnątrz current, więc żadna krawędź current
+    // nie może go wskazać ponownie.
+    Rectangle current = rect;
+    std::vector<size_t> partners;
+    while (true) {
+        // Sąsiad pod spodem ma górną krawędź równą dolnej krawędzi current
+        // i tak dalej dla pozostałych trzech stron.
+        std::optional<Rectangle> merged;
+        size_t partner = 0;
+        if (auto itr = top_edges_.find(bottom_edge(current));
+                itr != top_edges_.end()) {
+            partner = itr->second;
+            merged = merge_horizontally(*slots_[partner], current);
+        } else if (auto itr = bottom_edges_.find(top_edge(current));
+                itr != bottom_edges_.end()) {
+            partner = itr->second;
+            merged = merge_horizontally(current, *slots_[partner]);
+        } else if (auto itr = right_edges_.find(left_edge(current));
+                itr != right_edges_.end()) {
+            partner = itr->second;
+            merged = merge_vertically(*slots_[partner], current);
+        } else if (auto itr = left_edges_.find(right_edge(current));
+                itr != left_edges_.end()) {
+            partner = itr->second;
+            merged = merge_vertically(current, *slots_[partner]);
+        } else {
+            break;
+        }
+
+        partners.push_back(partner);
+        current = *merged;
+    }
+
+    // Dopiero teraz zmieniamy zbiór.
+    free_slots_.reserve(free_slots_.size() + partners.size());
+    for (size_t partner : partners) {
+        remove(partner);
+    }
+    add(current);
+}
+
+size_t StreamingMerger::size() const {
+    return size_;
+}
+
+Rectangles StreamingMerger::rectangles() const {
+    Rectangles result;
+    result.reserve(size_);
+    for (const std::optional<Rectangle> &slot : slots_) {
+        if (slot) {
+            result.push_back(*slot);
+        }
+    }
+    return result;
+}
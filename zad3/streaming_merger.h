@@ -0,0 +1,69 @@
+#ifndef STREAMING_MERGER_H
+#define STREAMING_MERGER_H
+
+#include "geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Zbiór prostokątów utrzymywany w postaci scalonej przy dodawaniu ich po
+// jednym. Nowy prostokąt jest scalany (według reguł can_merge_horizontally
+// i can_merge_vertically) z sąsiadem o wspólnej krawędzi, a wynik z kolejnym
+// sąsiadem, dopóki to możliwe. Sąsiedzi są wyszukiwani w tablicach
+// haszujących indeksowanych krawędziami, w oczekiwanym czasie O(1).
+//
+// Dodawane prostokąty nie mogą mieć wspólnych wnętrz z prostokątami zbioru.
+class StreamingMerger {
+private:
+    // Krawędź: współrzędna początku i stała współrzędna (dla krawędzi
+    // poziomej: x i y, dla pionowej: y i x) oraz długość.
+    struct Edge {
+        int64_t start;
+        int64_t line;
+        int64_t length;
+
+        bool operator==(const Edge &other) const;
+    };
+
+    struct EdgeHash {
+        size_t operator()(const Edge &edge) const;
+    };
+
+    using edge_map_t = std::unordered_map<Edge, size_t, EdgeHash>;
+
+    // Prostokąty zbioru; puste miejsca po scalonych są używane ponownie.
+    std::vector<std::optional<Rectangle>> slots_;
+    std::vector<size_t> free_slots_;
+    size_t size_ = 0;
+
+    edge_map_t bottom_edges_;
+    edge_map_t top_edges_;
+    edge_map_t left_edges_;
+    edge_map_t right_edges_;
+
+    static Edge bottom_edge(const Rectangle &rect);
+    static Edge top_edge(const Rectangle &rect);
+    static Edge left_edge(const Rectangle &rect);
+    static Edge right_edge(const Rectangle &rect);
+
+    void add(const Rectangle &rect);
+
+    void remove(size_t slot);
+
+public:
+    // konstruktory
+    StreamingMerger() = default;
+
+    // metody
+    void insert(const Rectangle &rect);
+
+    [[nodiscard]] size_t size() const;
+
+    // Aktualne prostokąty zbioru, w nieokreślonej kolejności.
+    [[nodiscard]] Rectangles rectangles() const;
+};
+
+#endif // STREAMING_MERGER_H
@@ -0,0 +1,255 @@
+#include "sweep_line.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace {
+    struct Interval {
+        int64_t begin;
+        int64_t end;
+    };
+
+    // Współrzędne y wszystkich prostokątów, posortowane i bez powtórzeń.
+    // Liść i drzewa przedziałowego odpowiada przedziałowi [ys[i], ys[i + 1]).
+    std::vector<int64_t> compressed_ys(const std::vector<Interval> &ys) {
+        std::vector<int64_t> result;
+        result.reserve(2 * ys.size());
+        for (const Interval &interval : ys) {
+            result.push_back(interval.begin);
+            result.push_back(interval.end);
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    size_t leaf_of(const std::vector<int64_t> &ys, int64_t y) {
+        return std::lower_bound(ys.begin(), ys.end(), y) - ys.begin();
+    }
+
+    // Drzewo przedziałowe nad liśćmi [0, ys.size() - 1), pamiętające, ile
+    // prostokątów pokrywa w całości każdy węzeł i jaka długość węzła jest
+    // pokryta.
+    class CoverTree {
+    private:
+        const std::vector<int64_t> &ys_;
+        std::vector<int> count_;
+        std::vector<int64_t> covered_;
+
+        void update(size_t node, size_t lo, size_t hi, size_t begin,
+                    size_t end, int delta) {
+            if (end <= lo || hi <= begin) {
+                return;
+            }
+            if (begin <= lo && hi <= end) {
+                count_[node] += delta;
+            } else {
+                size_t mid = (lo + hi) / 2;
+                update(2 * node, lo, mid, begin, end, delta);
+                update(2 * node + 1, mid, hi, begin, end, delta);
+            }
+
+            if (count_[node] > 0) {
+                covered_[node] = ys_[hi] - ys_[lo];
+            } else if (hi - lo == 1) {
+                covered_[node] = 0;
+            } else {
+                covered_[node] = covered_[2 * node] + covered_[2 * node + 1];
+            }
+        }
+
+    public:
+        explicit CoverTree(const std::vector<int64_t> &ys)
+                : ys_(ys), count_(4 * ys.size()), covered_(4 * ys.size()) {}
+
+        void add(size_t begin, size_t end, int delta) {
+            update(1, 0, ys_.size() - 1, begin, end, delta);
+        }
+
+        [[nodiscard]] int64_t covered() const {
+            return covered_[1];
+        }
+    };
+
+    // Drzewo przedziałowe odpowiadające na pytanie, które aktywne przedziały
+    // zawierają dany punkt. Przedział jest zapisany w O(log n) węzłach, które
+    // go rozkładają; usunięte przedziały są wyrzucane z list leniwie, przy
+    // pierwszym napotkaniu.
+    class StabbingTree {
+    private:
+        size_t leaves_;
+        std::vector<std::vector<size_t>> ids_;
+
+        void insert(size_t node, size_t lo, size_t hi, size_t begin,
+                    size_t end, size_t id) {
+            if (end <= lo || hi <= begin) {
+                return;
+            }
+            if (begin <= lo && hi <= end) {
+                ids_[node].push_back(id);
+                return;
+            }
+            size_t mid = (lo + hi) / 2;
+            insert(2 * node, lo, mid, begin, end, id);
+            insert(2 * node + 1, mid, hi, begin, end, id);
+        }
+
+    public:
+        explicit StabbingTree(size_t leaves)
+                : leaves_(leaves), ids_(4 * std::max<size_t>(leaves, 1)) {}
+
+        void insert(size_t begin, size_t end, size_t id) {
+            insert(1, 0, leaves_, begin, end, id);
+        }
+
+        // Wywołuje on_id dla każdego aktywnego przedziału zawierającego liść.
+        template <typename F>
+        void stab(size_t leaf, const std::vector<bool> &active, F on_id) {
+            size_t node = 1;
+            size_t lo = 0;
+            size_t hi = leaves_;
+            while (true) {
+                std::vector<size_t> &ids = ids_[node];
+                for (size_t i = 0; i < ids.size();) {
+                    if (active[ids[i]]) {
+                        on_id(ids[i]);
+                        ++i;
+                    } else {
+                        ids[i] = ids.back();
+                        ids.pop_back();
+                    }
+                }
+                if (hi - lo == 1) {
+                    return;
+                }
+                size_t mid = (lo + hi) / 2;
+                if (leaf < mid) {
+                    node = 2 * node;
+                    hi = mid;
+                } else {
+                    node = 2 * node + 1;
+                    lo = mid;
+                }
+            }
+        }
+    };
+
+    // Zdarzenie miotły: początek (x1) albo koniec (x2) prostokąta. Przy
+    // równych x końce są przetwarzane przed początkami, więc prostokąty
+    // stykające się krawędzią pionową nie są uznawane za przecinające się.
+    struct Event {
+        int64_t x;
+        bool is_begin;
+        size_t id;
+
+        bool operator<(const Event &other) const {
+            if (x != other.x) {
+                return x < other.x;
+            }
+            return is_begin < other.is_begin;
+        }
+    };
+
+    std::vector<Event> sweep_events(const Rectangles &rects) {
+        std::vector<Event> events;
+        events.reserve(2 * rects.size());
+        for (size_t id = 0; id < rects.size(); ++id) {
+            int64_t x = rects[id].pos().x();
+            events.push_back(Event{x, true, id});
+            events.push_back(Event{x + rects[id].width(), false, id});
+        }
+        std::sort(events.begin(), events.end());
+        return events;
+    }
+
+    std::vector<Interval> y_intervals(const Rectangles &rects) {
+        std::vector<Interval> result;
+        result.reserve(rects.size());
+        for (const Rectangle &rect : rects) {
+            int64_t y = rect.pos().y();
+            result.push_back(Interval{y, y + rect.height()});
+        }
+        return result;
+    }
+}
+
+int64_t union_area(const Rectangles &rects) {
+    if (rects.size() == 0) {
+        return 0;
+    }
+
+    std::vector<Interval> intervals = y_intervals(rects);
+    std::vector<int64_t> ys = compressed_ys(intervals);
+    CoverTree tree(ys);
+
+    int64_t result = 0;
+    int64_t previous_x = 0;
+    for (const Event &event : sweep_events(rects)) {
+        int64_t strip = 0;
+        if (__builtin_mul_overflow(event.x - previous_x, tree.covered(),
+                                   &strip) ||
+            __builtin_add_overflow(result, strip, &result)) {
+            throw std::overflow_error("geometry: area overflow");
+        }
+        previous_x = event.x;
+
+        const Interval &interval = intervals[event.id];
+        tree.add(leaf_of(ys, interval.begin), leaf_of(ys, interval.end),
+                 event.is_begin ? 1 : -1);
+    }
+    return result;
+}
+
+std::vector<std::pair<size_t, size_t>> intersecting_pairs(
+        const Rectangles &rects) {
+    std::vector<std::pair<size_t, size_t>> result;
+    if (rects.size() == 0) {
+        return result;
+    }
+
+    std::vector<Interval> intervals = y_intervals(rects);
+    std::vector<int64_t> ys = compressed_ys(intervals);
+
+    // Otwarte przedziały (a, b) i (c, d), a <= c, przecinają się wtedy
+    // i tylko wtedy, gdy c < b. Dla nowego przedziału [c, d) szukamy więc
+    // aktywnych przedziałów zaczynających się w [c, d) oraz tych, które
+    // zaczynają się przed c i zawierają c.
+    std::multimap<int64_t, size_t> active_by_begin;
+    std::vector<std::multimap<int64_t, size_t>::iterator> position(
+            rects.size());
+    std::vector<bool> active(rects.size(), false);
+    StabbingTree tree(ys.size() - 1);
+
+    for (const Event &event : sweep_events(rects)) {
+        const Interval &interval = intervals[event.id];
+        if (!event.is_begin) {
+            active[event.id] = false;
+            active_by_begin.erase(position[event.id]);
+            continue;
+        }
+
+        auto add_pair = [&](size_t other) {
+            result.emplace_back(std::min(other, event.id),
+                                std::max(other, event.id));
+        };
+        for (auto itr = active_by_begin.lower_bound(interval.begin);
+             itr != active_by_begin.end() && itr->first < interval.end;
+             ++itr) {
+            add_pair(itr->second);
+        }
+        size_t begin_leaf = leaf_of(ys, interval.begin);
+        tree.stab(begin_leaf, active, [&](size_t other) {
+            if (intervals[other].begin < interval.begin) {
+                add_pair(other);
+            }
+        });
+
+        active[event.id] = true;
+        position[event.id] = active_by_begin.emplace(interval.begin, event.id);
+        tree.insert(begin_leaf, leaf_of(ys, interval.end), event.id);
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
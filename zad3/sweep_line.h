@@ -0,0 +1,24 @@
+#ifndef SWEEP_LINE_H
+#define SWEEP_LINE_H
+
+#include "geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Algorytmy zamiatania dla nakładających się prostokątów. Prostokąt zajmuje
+// obszar [x, x + width) x [y, y + height), więc prostokąty, które się tylko
+// stykają, nie mają części wspólnej.
+
+// Pole sumy prostokątów (każdy punkt liczony raz), w czasie O(n log n).
+// Zgłasza std::overflow_error, gdy wynik nie mieści się w int64_t.
+int64_t union_area(const Rectangles &rects);
+
+// Wszystkie pary indeksów (i, j), i < j, prostokątów o niepustym przecięciu,
+// posortowane rosnąco. Czas O((n + k) log n) dla k par.
+std::vector<std::pair<size_t, size_t>> intersecting_pairs(
+        const Rectangles &rects);
+
+#endif // SWEEP_LINE_H
@@ -0,0 +1,28 @@
+#include "../geometry.h"
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cassert>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+int main() {
+    Rectangles rects{Rectangle(1, 2), Rectangle(3, 4, Position(5, 6))};
+    rects.append(std::move(rects));
+    assert(rects.size() == 4);
+    assert(rects[2] == Rectangle(1, 2));
+    assert(rects[3] == Rectangle(3, 4, Position(5, 6)));
+
+    Rectangles empty;
+    empty.append(std::move(empty));
+    assert(empty.size() == 0);
+
+    // Konstruktor z zakresem przyjmuje tylko iteratory.
+    std::vector<Rectangle> source{Rectangle(7, 8)};
+    Rectangles from_range(source.begin(), source.end());
+    assert(from_range.size() == 1);
+    static_assert(!std::is_constructible_v<Rectangles, int, int>);
+}
@@ -0,0 +1,42 @@
+#include "../streaming_merger.h"
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cassert>
+#include <climits>
+#include <stdexcept>
+
+int main() {
+    // A pod C, B nad C. Wstawienie C najpierw scala je z A, a potem wysokość
+    // scalenia z B przekracza INT_MAX.
+    Rectangle a(1, 1000, Position(0, -1000));
+    Rectangle b(1, INT_MAX - 1, Position(0, 1));
+    Rectangle c(1, 1, Position(0, 0));
+
+    StreamingMerger merger;
+    merger.insert(a);
+    merger.insert(b);
+    assert(merger.size() == 2);
+    Rectangles before = merger.rectangles();
+
+    bool thrown = false;
+    try {
+        merger.insert(c);
+    } catch (const std::overflow_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+    // Wyjątek zostawia zbiór bez zmian.
+    assert(merger.size() == 2);
+    assert(merger.rectangles() == before);
+
+    // Kaskada bez przepełnienia scala wszystkie trzy prostokąty.
+    StreamingMerger small;
+    small.insert(Rectangle(1, 2, Position(0, -2)));
+    small.insert(Rectangle(1, 3, Position(0, 1)));
+    small.insert(Rectangle(1, 1, Position(0, 0)));
+    assert(small.size() == 1);
+    assert(small.rectangles()[0] == Rectangle(1, 6, Position(0, -2)));
+}
@@ -0,0 +1,29 @@
+#include "../sweep_line.h"
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cassert>
+#include <climits>
+#include <stdexcept>
+
+int main() {
+    // Trzy prostokąty INT_MAX x INT_MAX jeden nad drugim: pokryta wysokość
+    // paska, pomnożona przez jego szerokość, nie mieści się w int64_t.
+    Rectangles rects{Rectangle(INT_MAX, INT_MAX, Position(0, INT_MIN)),
+                     Rectangle(INT_MAX, INT_MAX, Position(0, -1)),
+                     Rectangle(INT_MAX, INT_MAX, Position(0, INT_MAX))};
+    bool thrown = false;
+    try {
+        (void) union_area(rects);
+    } catch (const std::overflow_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Dwa takie prostokąty jeszcze się mieszczą.
+    Rectangles two{Rectangle(INT_MAX, INT_MAX, Position(0, INT_MIN)),
+                   Rectangle(INT_MAX, INT_MAX, Position(0, -1))};
+    assert(union_area(two) == 2 * int64_t(INT_MAX) * INT_MAX);
+}
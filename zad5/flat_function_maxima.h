@@ -0,0 +1,379 @@
+#ifndef FLAT_FUNCTION_MAXIMA_H
+#define FLAT_FUNCTION_MAXIMA_H
+#include "function_maxima.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Same interface as `FunctionMaxima`, but points are stored inline in two
+// sorted vectors: `function` ordered by argument and `maxima` ordered by
+// value (descending), then argument. Iteration is a linear scan over
+// contiguous memory.
+//
+// Differences from `FunctionMaxima`: `set_value` and `erase` are O(n)
+// (elements are shifted), and they invalidate all iterators. There is no
+// argument-ordered maxima index, so `maxima_in` is not provided.
+//
+// `set_value` and `erase` give the strong guarantee. All comparisons and
+// copies of `A` and `V` happen before anything is modified. When moving a
+// point cannot throw, the containers are then edited in place; otherwise
+// the edit is applied to a copy that is swapped in.
+//
+// Unlike `FunctionMaxima`, `A` and `V` must also be move-assignable: the
+// vectors shift their elements by assignment on insertion and erasure.
+template <typename A, typename V>
+class FlatFunctionMaxima {
+    static_assert(std::is_move_assignable_v<A> and std::is_move_assignable_v<V>,
+        "FlatFunctionMaxima stores points in vectors and needs move-assignable A and V; use FunctionMaxima otherwise");
+
+public:
+    class point_type {
+        A arg_;
+        V value_;
+
+        point_type(const A& arg, const V& value)
+            : arg_(arg)
+            , value_(value)
+        {
+        }
+
+    public:
+        const A& arg() const noexcept
+        {
+            return arg_;
+        }
+
+        const V& value() const noexcept
+        {
+            return value_;
+        }
+        friend class FlatFunctionMaxima;
+    };
+
+    using size_type = size_t;
+    using iterator = typename std::vector<point_type>::const_iterator;
+    using mx_iterator = typename std::vector<point_type>::const_iterator;
+
+private:
+    struct PointArgComp {
+        bool operator()(const point_type& lhs, const A& rhs) const
+        {
+            return lhs.arg() < rhs;
+        }
+    };
+
+    struct PointValThenArgComp {
+        bool operator()(const point_type& lhs, const point_type& rhs) const
+        {
+            if (not(lhs.value() < rhs.value()) and not(rhs.value() < lhs.value())) {
+                return lhs.arg() < rhs.arg();
+            } else {
+                return rhs.value() < lhs.value();
+            }
+        }
+    };
+
+    static constexpr bool nothrow_edit = std::is_nothrow_move_constructible_v<point_type>
+        and std::is_nothrow_move_assignable_v<point_type>;
+
+    std::vector<point_type> function;
+    std::vector<point_type> maxima;
+
+    // Changes to `maxima` caused by a single `set_value` or `erase`, computed
+    // before anything is modified. At most three points (the changed one and
+    // its two neighbours) enter or leave the maxima.
+    struct MaximaChanges {
+        std::array<size_t, 3> erase_at {};
+        size_t erase_count = 0;
+        // Sorted by `PointValThenArgComp`; `insert_at` are positions in
+        // `maxima` before any change.
+        std::array<std::optional<point_type>, 3> insert;
+        std::array<size_t, 3> insert_at {};
+        size_t insert_count = 0;
+    };
+
+    // Either pointer may be null when there is no neighbour on that side.
+    static bool is_local_maximum(const point_type* left, const point_type& p, const point_type* right)
+    {
+        return (left == nullptr or not(p.value() < left->value()))
+            and (right == nullptr or not(p.value() < right->value()));
+    }
+
+    size_t function_position(const A& a) const
+    {
+        return std::lower_bound(std::begin(function), std::end(function), a, PointArgComp()) - std::begin(function);
+    }
+
+    bool function_contains(size_t position, const A& a) const
+    {
+        return position < function.size() and not(a < function[position].arg());
+    }
+
+    size_t maxima_position(const point_type& p) const
+    {
+        return std::lower_bound(std::begin(maxima), std::end(maxima), p, PointValThenArgComp()) - std::begin(maxima);
+    }
+
+    bool maxima_contains(size_t position, const point_type& p) const
+    {
+        return position < maxima.size() and not PointValThenArgComp()(p, maxima[position]);
+    }
+
+    void plan_erase(MaximaChanges& changes, const point_type& p) const
+    {
+        size_t position = maxima_position(p);
+        if (maxima_contains(position, p)) {
+            changes.erase_at[changes.erase_count++] = position;
+        }
+    }
+
+    void plan_insert(MaximaChanges& changes, const point_type& p) const
+    {
+        changes.insert[changes.insert_count].emplace(p);
+        changes.insert_at[changes.insert_count] = maxima_position(p);
+        ++changes.insert_count;
+    }
+
+    // Records the change for an existing point whose neighbours change.
+    void plan_neighbour(MaximaChanges& changes, const point_type& p, const point_type* left,
+        const point_type* right) const
+    {
+        size_t position = maxima_position(p);
+        bool was_maximum = maxima_contains(position, p);
+        bool is_maximum = is_local_maximum(left, p, right);
+        if (was_maximum and not is_maximum) {
+            changes.erase_at[changes.erase_count++] = position;
+        } else if (is_maximum and not was_maximum) {
+            plan_insert(changes, p);
+        }
+    }
+
+    void sort_insertions(MaximaChanges& changes) const
+    {
+        // Insertion sort on at most three elements.
+        for (size_t i = 1; i < changes.insert_count; ++i) {
+            for (size_t j = i; j > 0 and PointValThenArgComp()(*changes.insert[j], *changes.insert[j - 1]); --j) {
+                std::swap(changes.insert[j], changes.insert[j - 1]);
+                std::swap(changes.insert_at[j], changes.insert_at[j - 1]);
+            }
+        }
+    }
+
+    // Applies planned changes. Does not compare or copy `A` and `V`, so it
+    // cannot throw when `nothrow_edit` holds and capacity is reserved.
+    static void apply(std::vector<point_type>& maxima, MaximaChanges& changes)
+    {
+        std::array<size_t, 3> erase_at = changes.erase_at;
+        std::sort(std::begin(erase_at), std::begin(erase_at) + changes.erase_count);
+        for (size_t i = changes.erase_count; i > 0; --i) {
+            maxima.erase(std::begin(maxima) + erase_at[i - 1]);
+        }
+
+        for (size_t i = 0; i < changes.insert_count; ++i) {
+            size_t position = changes.insert_at[i] + i;
+            for (size_t j = 0; j < changes.erase_count; ++j) {
+                if (erase_at[j] < changes.insert_at[i]) {
+                    --position;
+                }
+            }
+            maxima.insert(std::begin(maxima) + position, std::move(*changes.insert[i]));
+        }
+    }
+
+    // Runs `edit` on `*this` directly when it cannot throw, and on a copy
+    // that is then swapped in otherwise.
+    template <typename Edit>
+    void transactional(const MaximaChanges& changes, Edit edit)
+    {
+        if constexpr (nothrow_edit) {
+            function.reserve(function.size() + 1);
+            maxima.reserve(maxima.size() + changes.insert_count);
+            edit(*this);
+        } else {
+            FlatFunctionMaxima copy(*this);
+            edit(copy);
+            this->swap(copy);
+        }
+    }
+
+    void swap(FlatFunctionMaxima& other) noexcept
+    {
+        this->function.swap(other.function);
+        this->maxima.swap(other.maxima);
+    }
+
+public:
+    FlatFunctionMaxima() = default;
+    FlatFunctionMaxima(const FlatFunctionMaxima& other) = default;
+    FlatFunctionMaxima& operator=(FlatFunctionMaxima other) noexcept
+    {
+        this->swap(other);
+        return (*this);
+    }
+
+    // Builds the function from a range of (argument, value) pairs in one
+    // pass, in O(n log n). For repeated arguments the last value wins.
+    template <typename InputIt>
+    FlatFunctionMaxima(InputIt first, InputIt last);
+
+    const V& value_at(const A& a) const;
+
+    void set_value(const A& a, const V& v);
+
+    void erase(const A& a);
+
+    iterator begin() const noexcept
+    {
+        return std::begin(function);
+    }
+
+    iterator end() const noexcept
+    {
+        return std::end(function);
+    }
+
+    iterator find(const A& a) const
+    {
+        size_t position = function_position(a);
+        return function_contains(position, a) ? std::begin(function) + position : std::end(function);
+    }
+
+    mx_iterator mx_begin() const noexcept
+    {
+        return std::begin(maxima);
+    }
+
+    mx_iterator mx_end() const noexcept
+    {
+        return std::end(maxima);
+    }
+
+    // The `k` largest maxima (all of them if there are fewer), in the order
+    // of `mx_begin()`. O(1).
+    std::pair<mx_iterator, mx_iterator> top_k(size_type k) const noexcept
+    {
+        return {std::begin(maxima), std::begin(maxima) + std::min(k, maxima.size())};
+    }
+
+    size_type size() const noexcept
+    {
+        return function.size();
+    }
+};
+
+template <typename A, typename V>
+template <typename InputIt>
+FlatFunctionMaxima<A, V>::FlatFunctionMaxima(InputIt first, InputIt last)
+{
+    for (; first != last; ++first) {
+        function.push_back(point_type(first->first, first->second));
+    }
+
+    // Stable sort keeps the input order of equal arguments, so the last
+    // occurrence can be kept.
+    std::stable_sort(std::begin(function), std::end(function),
+        [](const point_type& lhs, const point_type& rhs) { return lhs.arg() < rhs.arg(); });
+    auto last_of_each = std::begin(function);
+    for (auto it = std::begin(function); it != std::end(function); ++it) {
+        if (std::next(it) == std::end(function) or it->arg() < std::next(it)->arg()) {
+            if (last_of_each != it) {
+                *last_of_each = std::move(*it);
+            }
+            ++last_of_each;
+        }
+    }
+    function.erase(last_of_each, std::end(function));
+
+    for (size_t i = 0; i < function.size(); ++i) {
+        const point_type* left = i > 0 ? &function[i - 1] : nullptr;
+        const point_type* right = i + 1 < function.size() ? &function[i + 1] : nullptr;
+        if (is_local_maximum(left, function[i], right)) {
+            maxima.push_back(function[i]);
+        }
+    }
+    std::sort(std::begin(maxima), std::end(maxima), PointValThenArgComp());
+}
+
+template <typename A, typename V>
+const V& FlatFunctionMaxima<A, V>::value_at(const A& a) const
+{
+    size_t position = function_position(a);
+    if (not function_contains(position, a)) {
+        throw InvalidArg();
+    } else {
+        return function[position].value();
+    }
+}
+
+template <typename A, typename V>
+void FlatFunctionMaxima<A, V>::set_value(const A& a, const V& v)
+{
+    size_t position = function_position(a);
+    bool exists = function_contains(position, a);
+
+    if (exists and not(v < function[position].value()) and not(function[position].value() < v)) {
+        return;
+    }
+
+    point_type new_point(a, v);
+    const point_type* prev = position > 0 ? &function[position - 1] : nullptr;
+    size_t next_position = exists ? position + 1 : position;
+    const point_type* next = next_position < function.size() ? &function[next_position] : nullptr;
+
+    MaximaChanges changes;
+    if (exists) {
+        plan_erase(changes, function[position]);
+    }
+    if (is_local_maximum(prev, new_point, next)) {
+        plan_insert(changes, new_point);
+    }
+    if (prev != nullptr) {
+        plan_neighbour(changes, *prev, position > 1 ? &function[position - 2] : nullptr, &new_point);
+    }
+    if (next != nullptr) {
+        plan_neighbour(changes, *next, &new_point, next_position + 1 < function.size() ? &function[next_position + 1] : nullptr);
+    }
+    sort_insertions(changes);
+
+    transactional(changes, [&](FlatFunctionMaxima& target) {
+        if (exists) {
+            target.function[position] = std::move(new_point);
+        } else {
+            target.function.insert(std::begin(target.function) + position, std::move(new_point));
+        }
+        apply(target.maxima, changes);
+    });
+}
+
+template <typename A, typename V>
+void FlatFunctionMaxima<A, V>::erase(const A& a)
+{
+    size_t position = function_position(a);
+    if (not function_contains(position, a)) {
+        return;
+    }
+
+    const point_type* prev = position > 0 ? &function[position - 1] : nullptr;
+    const point_type* next = position + 1 < function.size() ? &function[position + 1] : nullptr;
+
+    MaximaChanges changes;
+    plan_erase(changes, function[position]);
+    if (prev != nullptr) {
+        plan_neighbour(changes, *prev, position > 1 ? &function[position - 2] : nullptr, next);
+    }
+    if (next != nullptr) {
+        plan_neighbour(changes, *next, prev, position + 2 < function.size() ? &function[position + 2] : nullptr);
+    }
+    sort_insertions(changes);
+
+    transactional(changes, [&](FlatFunctionMaxima& target) {
+        target.function.erase(std::begin(target.function) + position);
+        apply(target.maxima, changes);
+    });
+}
+#endif
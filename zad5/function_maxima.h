@@ -1,10 +1,17 @@
 #ifndef FUNCTION_MAXIMA_H
 #define FUNCTION_MAXIMA_H
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstddef>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <set>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 struct InvalidArg : public std::exception {
     virtual const char* what() const noexcept
@@ -13,26 +20,33 @@ struct InvalidArg : public std::exception {
     }
 };
 
-template <typename A, typename V>
+// `Alloc` is rebound to the node types of both indexes, e.g.
+// `NodePoolAllocator<char>` from node_pool_allocator.h serves the nodes from
+// a free list.
+template <typename A, typename V, typename Alloc = std::allocator<char>>
 class FunctionMaxima {
 public:
+    // The argument and value are stored inline, so a point lives directly
+    // in its `function` node; `maxima` only points at those nodes.
     class point_type {
-        std::shared_ptr<std::pair<A, V>> arg_and_val;
+        A arg_;
+        V value_;
 
         point_type(const A& arg, const V& value)
-            : arg_and_val(std::make_shared<std::pair<A, V>>(arg, value))
+            : arg_(arg)
+            , value_(value)
         {
         }
 
     public:
         const A& arg() const noexcept
         {
-            return (*arg_and_val).first;
+            return arg_;
         }
 
         const V& value() const noexcept
         {
-            return (*arg_and_val).second;
+            return value_;
         }
         friend class FunctionMaxima;
     };
@@ -56,25 +70,133 @@ private:
         }
     };
 
+    // Compares the points that `maxima` refers to.
     struct PointValThenArgComp {
-        bool operator()(const point_type& lhs, const point_type& rhs) const
+        bool operator()(const point_type* lhs, const point_type* rhs) const
         {
-            if (not(lhs.value() < rhs.value()) and not(rhs.value() < lhs.value())) {
-                return lhs.arg() < rhs.arg();
+            if (not(lhs->value() < rhs->value()) and not(rhs->value() < lhs->value())) {
+                return lhs->arg() < rhs->arg();
             } else {
-                return rhs.value() < lhs.value();
+                return rhs->value() < lhs->value();
             }
         }
     };
 
+    // Orders the points of `maxima_by_arg` by argument. While `set_value`
+    // runs, the old and the new point of the same argument may both be
+    // indexed, so ties are broken by address.
+    struct PointPtrArgComp {
+        using is_transparent = void;
+        bool operator()(const point_type* lhs, const point_type* rhs) const
+        {
+            if (lhs->arg() < rhs->arg()) {
+                return true;
+            } else if (rhs->arg() < lhs->arg()) {
+                return false;
+            } else {
+                return std::less<const point_type*>()(lhs, rhs);
+            }
+        }
+
+        bool operator()(const A& lhs, const point_type* rhs) const
+        {
+            return lhs < rhs->arg();
+        }
+
+        bool operator()(const point_type* lhs, const A& rhs) const
+        {
+            return lhs->arg() < rhs;
+        }
+    };
+
+    template <typename T>
+    using rebind_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+    using function_set = std::multiset<point_type, PointArgComp, rebind_alloc<point_type>>;
+    using maxima_set = std::set<const point_type*, PointValThenArgComp, rebind_alloc<const point_type*>>;
+    using maxima_iterator = typename maxima_set::const_iterator;
+    using maxima_by_arg_set = std::set<const point_type*, PointPtrArgComp, rebind_alloc<const point_type*>>;
+    using maxima_by_arg_iterator = typename maxima_by_arg_set::const_iterator;
+
 public:
     using size_type = size_t;
-    using iterator = typename std::multiset<point_type, PointArgComp>::const_iterator;
-    using mx_iterator = typename std::set<point_type, PointValThenArgComp>::const_iterator;
+    using iterator = typename function_set::const_iterator;
+
+    // Iterates over one of the maxima indexes, dereferencing to the points
+    // stored in `function`.
+    template <typename SetIterator>
+    class basic_mx_iterator {
+        SetIterator it;
+
+        explicit basic_mx_iterator(const SetIterator& it)
+            : it(it)
+        {
+        }
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = point_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const point_type*;
+        using reference = const point_type&;
+
+        basic_mx_iterator() = default;
+
+        reference operator*() const noexcept
+        {
+            return **it;
+        }
+
+        pointer operator->() const noexcept
+        {
+            return *it;
+        }
+
+        basic_mx_iterator& operator++() noexcept
+        {
+            ++it;
+            return *this;
+        }
+
+        basic_mx_iterator operator++(int) noexcept
+        {
+            return basic_mx_iterator(it++);
+        }
+
+        basic_mx_iterator& operator--() noexcept
+        {
+            --it;
+            return *this;
+        }
+
+        basic_mx_iterator operator--(int) noexcept
+        {
+            return basic_mx_iterator(it--);
+        }
+
+        bool operator==(const basic_mx_iterator& other) const noexcept
+        {
+            return it == other.it;
+        }
+
+        bool operator!=(const basic_mx_iterator& other) const noexcept
+        {
+            return it != other.it;
+        }
+        friend class FunctionMaxima;
+    };
+
+    // Maxima ordered by value (descending), then argument.
+    using mx_iterator = basic_mx_iterator<maxima_iterator>;
+    // Maxima ordered by argument.
+    using mx_arg_iterator = basic_mx_iterator<maxima_by_arg_iterator>;
 
 private:
-    std::multiset<point_type, PointArgComp> function;
-    std::set<point_type, PointValThenArgComp> maxima;
+    function_set function;
+    // Pointers into the nodes of `function`, which never move.
+    maxima_set maxima;
+    // The same points as `maxima`, ordered by argument, for `maxima_in`.
+    maxima_by_arg_set maxima_by_arg;
 
     // Set `ign_it` to `std::end(function)` if nothing to be ignored.
     iterator fun_prev(const iterator& it, const iterator& ign_it) const noexcept;
@@ -101,25 +223,64 @@ private:
     {
         this->function.swap(other.function);
         this->maxima.swap(other.maxima);
+        this->maxima_by_arg.swap(other.maxima_by_arg);
     }
 
+    // Fills both maxima indexes of an object whose indexes are empty with
+    // the local maxima of `function`, in one pass plus a sort.
+    void build_maxima();
+
+    // Builds both indexes of an empty object from points sorted by argument,
+    // with unique arguments. Nodes are appended at the end, so each insert
+    // is amortised O(1).
+    void build(std::vector<point_type>&& points);
+
+    // A batch at most this many times smaller than the function is applied
+    // point by point; larger ones rebuild both indexes.
+    static constexpr size_t INCREMENTAL_BATCH_RATIO = 16;
+
+    // While a batch is applied, the old point of an overwritten argument
+    // stays in `function` right before the new one until the end.
+    bool is_replaced(const iterator& it) const
+    {
+        auto next = std::next(it);
+        return next != std::end(function) and not(it->arg() < next->arg());
+    }
+
+    // Neighbours skipping replaced points; `std::end(function)` if none.
+    iterator effective_prev(iterator it) const;
+    iterator effective_next(iterator it) const;
+
+    // `set_values` for batches small compared with `function`, in
+    // O(k log(n + k)). Nothing is erased until every insertion succeeded, so
+    // rolling back only erases what was inserted and cannot throw.
+    void apply_batch(std::vector<point_type>&& batch);
+
+    // `set_values` by merging and rebuilding both indexes, in O(n + k).
+    void rebuild_with(std::vector<point_type>&& batch);
+
+    // Reads (argument, value) pairs and sorts them by argument, keeping the
+    // last value of repeated arguments. Needs no assignment of `A` or `V`.
+    template <typename InputIt>
+    static std::vector<point_type> sorted_points(InputIt first, InputIt last);
+
     // Helper class for `set_value` and `erase` exception safe implementations
-    template <size_t MAX_SIZE>
+    template <size_t MAX_SIZE, typename Set = maxima_set>
     class MaximaEraseList {
-        std::set<point_type, PointValThenArgComp>& maxima;
-        std::array<mx_iterator, MAX_SIZE> erase_list;
+        Set& maxima;
+        std::array<typename Set::const_iterator, MAX_SIZE> erase_list;
         size_t size;
         bool processed = false;
 
     public:
-        MaximaEraseList(std::set<point_type, PointValThenArgComp>& maxima)
+        MaximaEraseList(Set& maxima)
             : maxima(maxima)
             , erase_list()
             , size(0)
         {
         }
 
-        void add(const mx_iterator& it) noexcept
+        void add(const typename Set::const_iterator& it) noexcept
         {
             assert(size < MAX_SIZE);
             erase_list[size] = it;
@@ -140,13 +301,43 @@ private:
 
 public:
     FunctionMaxima() = default;
-    FunctionMaxima(const FunctionMaxima& other) = default;
+    // `maxima` of the copy must point into the copied nodes, so it is
+    // rebuilt from the local maxima of the copied function.
+    FunctionMaxima(const FunctionMaxima& other)
+        : function(other.function)
+    {
+        build_maxima();
+    }
     FunctionMaxima& operator=(FunctionMaxima other) noexcept
     {
         this->swap(other);
         return (*this);
     }
 
+    // Builds the function from a range of (argument, value) pairs, e.g.
+    // `std::pair<A, V>`, in O(n log n). For repeated arguments the last
+    // value wins.
+    template <typename InputIt>
+    FunctionMaxima(InputIt first, InputIt last)
+    {
+        build(sorted_points(first, last));
+    }
+
+    // Replaces the whole function with the given (argument, value) pairs.
+    // Strong exception guarantee.
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last)
+    {
+        FunctionMaxima result(first, last);
+        this->swap(result);
+    }
+
+    // Equivalent to calling `set_value` for each pair. Small batches are
+    // applied in O(k log(n + k)) for k pairs, large ones rebuild the function
+    // in O(n + k log k). Strong exception guarantee.
+    template <typename InputIt>
+    void set_values(InputIt first, InputIt last);
+
     const V& value_at(const A& a) const;
 
     void set_value(const A& a, const V& v);
@@ -170,12 +361,33 @@ public:
 
     mx_iterator mx_begin() const noexcept
     {
-        return std::begin(maxima);
+        return mx_iterator(std::begin(maxima));
     }
 
     mx_iterator mx_end() const noexcept
     {
-        return std::end(maxima);
+        return mx_iterator(std::end(maxima));
+    }
+
+    // The `k` largest maxima (all of them if there are fewer), in the order
+    // of `mx_begin()`. O(k).
+    std::pair<mx_iterator, mx_iterator> top_k(size_type k) const noexcept
+    {
+        auto last = std::begin(maxima);
+        for (size_type i = 0; i < k and last != std::end(maxima); ++i) {
+            ++last;
+        }
+        return {mx_iterator(std::begin(maxima)), mx_iterator(last)};
+    }
+
+    // Maxima with arguments in [lo, hi], ordered by argument.
+    // O(log n) plus the length of the range.
+    std::pair<mx_arg_iterator, mx_arg_iterator> maxima_in(const A& lo, const A& hi) const
+    {
+        if (hi < lo) {
+            return {mx_arg_iterator(std::end(maxima_by_arg)), mx_arg_iterator(std::end(maxima_by_arg))};
+        }
+        return {mx_arg_iterator(maxima_by_arg.lower_bound(lo)), mx_arg_iterator(maxima_by_arg.upper_bound(hi))};
     }
 
     size_type size() const noexcept
@@ -185,8 +397,8 @@ public:
 };
 
 // Set `ign_it` to `std::end(function)` if nothing to be ignored.
-template <typename A, typename V>
-typename FunctionMaxima<A, V>::iterator FunctionMaxima<A, V>::fun_prev(
+template <typename A, typename V, typename Alloc>
+typename FunctionMaxima<A, V, Alloc>::iterator FunctionMaxima<A, V, Alloc>::fun_prev(
     const iterator& it, const iterator& ign_it) const noexcept
 {
     if (it == std::begin(function)) {
@@ -203,8 +415,8 @@ typename FunctionMaxima<A, V>::iterator FunctionMaxima<A, V>::fun_prev(
 }
 
 // Set `ign_it` to `std::end(function)` if nothing to be ignored.
-template <typename A, typename V>
-typename FunctionMaxima<A, V>::iterator FunctionMaxima<A, V>::fun_next(
+template <typename A, typename V, typename Alloc>
+typename FunctionMaxima<A, V, Alloc>::iterator FunctionMaxima<A, V, Alloc>::fun_next(
     const iterator& it, const iterator& ign_it) const noexcept
 {
     if (std::next(it) == std::end(function)) {
@@ -217,8 +429,228 @@ typename FunctionMaxima<A, V>::iterator FunctionMaxima<A, V>::fun_next(
     return result;
 }
 
-template <typename A, typename V>
-const V& FunctionMaxima<A, V>::value_at(const A& a) const
+template <typename A, typename V, typename Alloc>
+void FunctionMaxima<A, V, Alloc>::build_maxima()
+{
+    std::vector<const point_type*> points;
+    for (auto it = std::begin(function); it != std::end(function); ++it) {
+        if (refers_to_local_maxima(it, std::end(function))) {
+            points.push_back(&*it);
+            maxima_by_arg.insert(std::end(maxima_by_arg), &*it);
+        }
+    }
+    std::sort(std::begin(points), std::end(points), PointValThenArgComp());
+    for (const point_type* point : points) {
+        maxima.insert(std::end(maxima), point);
+    }
+}
+
+template <typename A, typename V, typename Alloc>
+void FunctionMaxima<A, V, Alloc>::build(std::vector<point_type>&& points)
+{
+    for (point_type& point : points) {
+        function.insert(std::end(function), std::move(point));
+    }
+    build_maxima();
+}
+
+template <typename A, typename V, typename Alloc>
+template <typename InputIt>
+std::vector<typename FunctionMaxima<A, V, Alloc>::point_type> FunctionMaxima<A, V, Alloc>::sorted_points(
+    InputIt first, InputIt last)
+{
+    std::vector<point_type> input;
+    for (; first != last; ++first) {
+        input.push_back(point_type(first->first, first->second));
+    }
+
+    // Points are only ever constructed, never assigned, so `A` and `V` need
+    // not be assignable. Stable sort keeps the input order of equal
+    // arguments, so the last one can be kept.
+    std::vector<point_type*> order;
+    order.reserve(input.size());
+    for (point_type& point : input) {
+        order.push_back(&point);
+    }
+    std::stable_sort(std::begin(order), std::end(order),
+        [](const point_type* lhs, const point_type* rhs) { return lhs->arg() < rhs->arg(); });
+
+    std::vector<point_type> points;
+    points.reserve(order.size());
+    for (auto it = std::begin(order); it != std::end(order); ++it) {
+        if (std::next(it) == std::end(order) or (*it)->arg() < (*std::next(it))->arg()) {
+            points.push_back(std::move(**it));
+        }
+    }
+    return points;
+}
+
+template <typename A, typename V, typename Alloc>
+template <typename InputIt>
+void FunctionMaxima<A, V, Alloc>::set_values(InputIt first, InputIt last)
+{
+    std::vector<point_type> batch = sorted_points(first, last);
+    if (batch.empty()) {
+        return;
+    }
+    if (batch.size() * INCREMENTAL_BATCH_RATIO <= function.size()) {
+        apply_batch(std::move(batch));
+    } else {
+        rebuild_with(std::move(batch));
+    }
+}
+
+template <typename A, typename V, typename Alloc>
+typename FunctionMaxima<A, V, Alloc>::iterator FunctionMaxima<A, V, Alloc>::effective_prev(iterator it) const
+{
+    do {
+        if (it == std::begin(function)) {
+            return std::end(function);
+        }
+        --it;
+    } while (is_replaced(it));
+    return it;
+}
+
+template <typename A, typename V, typename Alloc>
+typename FunctionMaxima<A, V, Alloc>::iterator FunctionMaxima<A, V, Alloc>::effective_next(iterator it) const
+{
+    do {
+        ++it;
+    } while (it != std::end(function) and is_replaced(it));
+    return it;
+}
+
+template <typename A, typename V, typename Alloc>
+void FunctionMaxima<A, V, Alloc>::apply_batch(std::vector<point_type>&& batch)
+{
+    // All bookkeeping is reserved up front, so recording a change cannot
+    // throw once the change has been made.
+    std::vector<iterator> inserted;
+    std::vector<iterator> replaced;
+    std::vector<const point_type*> affected;
+    std::vector<maxima_iterator> maxima_inserted, maxima_erased;
+    std::vector<maxima_by_arg_iterator> by_arg_inserted, by_arg_erased;
+    inserted.reserve(batch.size());
+    replaced.reserve(batch.size());
+    affected.reserve(3 * batch.size());
+    maxima_inserted.reserve(3 * batch.size());
+    by_arg_inserted.reserve(3 * batch.size());
+    maxima_erased.reserve(4 * batch.size());
+    by_arg_erased.reserve(4 * batch.size());
+
+    try {
+        for (point_type& point : batch) {
+            auto old_it = function.find(point.arg());
+            if (old_it != std::end(function) and not(point.value() < old_it->value())
+                and not(old_it->value() < point.value())) {
+                continue;
+            }
+            // A multiset inserts after the equal argument, so the old point
+            // ends up right before the new one.
+            inserted.push_back(function.insert(std::move(point)));
+            if (old_it != std::end(function)) {
+                replaced.push_back(old_it);
+            }
+        }
+
+        for (const iterator& it : inserted) {
+            affected.push_back(&*it);
+            for (auto neighbour : {effective_prev(it), effective_next(it)}) {
+                if (neighbour != std::end(function)) {
+                    affected.push_back(&*neighbour);
+                }
+            }
+        }
+        std::sort(std::begin(affected), std::end(affected), std::less<const point_type*>());
+        affected.erase(std::unique(std::begin(affected), std::end(affected)), std::end(affected));
+
+        for (const iterator& it : replaced) {
+            auto mxit = maxima.find(&*it);
+            if (mxit != std::end(maxima)) {
+                maxima_erased.push_back(mxit);
+                by_arg_erased.push_back(maxima_by_arg.find(&*it));
+            }
+        }
+
+        for (const point_type* point : affected) {
+            auto it = function.lower_bound(point->arg());
+            while (&*it != point) {
+                ++it;
+            }
+            auto prev = effective_prev(it);
+            auto next = effective_next(it);
+            bool is_maximum = (prev == std::end(function) or not(point->value() < prev->value()))
+                and (next == std::end(function) or not(point->value() < next->value()));
+            if (is_maximum) {
+                const auto& [mxit, success] = maxima.insert(point);
+                if (success) {
+                    maxima_inserted.push_back(mxit);
+                    by_arg_inserted.push_back(maxima_by_arg.insert(point).first);
+                }
+            } else {
+                auto mxit = maxima.find(point);
+                if (mxit != std::end(maxima)) {
+                    maxima_erased.push_back(mxit);
+                    by_arg_erased.push_back(maxima_by_arg.find(point));
+                }
+            }
+        }
+    } catch (...) {
+        // Undoes every insertion: the two index lists may differ in length
+        // by one if the second insertion threw.
+        for (const auto& mxit : maxima_inserted) {
+            maxima.erase(mxit);
+        }
+        for (const auto& bit : by_arg_inserted) {
+            maxima_by_arg.erase(bit);
+        }
+        for (const iterator& it : inserted) {
+            function.erase(it);
+        }
+        throw;
+    }
+
+    for (const auto& mxit : maxima_erased) {
+        maxima.erase(mxit);
+    }
+    for (const auto& bit : by_arg_erased) {
+        maxima_by_arg.erase(bit);
+    }
+    for (const iterator& it : replaced) {
+        function.erase(it);
+    }
+}
+
+template <typename A, typename V, typename Alloc>
+void FunctionMaxima<A, V, Alloc>::rebuild_with(std::vector<point_type>&& batch)
+{
+    // Merges the current points with the batch; the batch wins on equal
+    // arguments.
+    std::vector<point_type> points;
+    points.reserve(function.size() + batch.size());
+    auto it = std::begin(function);
+    auto batch_it = std::begin(batch);
+    while (it != std::end(function) or batch_it != std::end(batch)) {
+        if (batch_it == std::end(batch)) {
+            points.push_back(*it++);
+        } else if (it == std::end(function) or batch_it->arg() < it->arg()) {
+            points.push_back(std::move(*batch_it++));
+        } else if (it->arg() < batch_it->arg()) {
+            points.push_back(*it++);
+        } else {
+            points.push_back(std::move(*batch_it++));
+            ++it;
+        }
+    }
+
+    FunctionMaxima result;
+    result.build(std::move(points));
+    this->swap(result);
+}
+
+template <typename A, typename V, typename Alloc>
+const V& FunctionMaxima<A, V, Alloc>::value_at(const A& a) const
 {
     auto it = function.find(a);
     if (it == std::end(function)) {
@@ -228,11 +660,12 @@ const V& FunctionMaxima<A, V>::value_at(const A& a) const
     }
 }
 
-template <typename A, typename V>
-void FunctionMaxima<A, V>::set_value(const A& a, const V& v)
+template <typename A, typename V, typename Alloc>
+void FunctionMaxima<A, V, Alloc>::set_value(const A& a, const V& v)
 {
     constexpr size_t MAX_LEN_TO_ERASE = 4;
     MaximaEraseList<MAX_LEN_TO_ERASE> inserted(maxima), to_erase(maxima);
+    MaximaEraseList<MAX_LEN_TO_ERASE, maxima_by_arg_set> inserted_by_arg(maxima_by_arg), to_erase_by_arg(maxima_by_arg);
 
     auto old_val_it = function.find(a);
 
@@ -241,7 +674,8 @@ void FunctionMaxima<A, V>::set_value(const A& a, const V& v)
     }
 
     if (old_val_it != std::end(function)) {
-        to_erase.add(maxima.find(*old_val_it));
+        to_erase.add(maxima.find(&*old_val_it));
+        to_erase_by_arg.add(maxima_by_arg.find(&*old_val_it));
     }
 
     auto new_val_it = function.insert(point_type(a, v));
@@ -250,18 +684,21 @@ void FunctionMaxima<A, V>::set_value(const A& a, const V& v)
         for (auto it : {fun_prev(new_val_it, old_val_it), new_val_it, fun_next(new_val_it, old_val_it)}) {
             if (it != std::end(function)) {
                 if (refers_to_local_maxima(it, old_val_it)) {
-                    const auto& [mxit, success] = maxima.insert(*it);
+                    const auto& [mxit, success] = maxima.insert(&*it);
                     if (success) {
                         inserted.add(mxit);
+                        inserted_by_arg.add(maxima_by_arg.insert(&*it).first);
                     }
                 } else {
-                    to_erase.add(maxima.find(*it));
+                    to_erase.add(maxima.find(&*it));
+                    to_erase_by_arg.add(maxima_by_arg.find(&*it));
                 }
             }
         }
     } catch (...) {
         function.erase(new_val_it);
         inserted.process();
+        inserted_by_arg.process();
         throw;
     }
 
@@ -270,39 +707,49 @@ void FunctionMaxima<A, V>::set_value(const A& a, const V& v)
     }
 
     to_erase.process();
+    to_erase_by_arg.process();
 }
 
-template <typename A, typename V>
-void FunctionMaxima<A, V>::erase(const A& a)
+template <typename A, typename V, typename Alloc>
+void FunctionMaxima<A, V, Alloc>::erase(const A& a)
 {
     constexpr size_t MAX_LEN_TO_ERASE = 3;
     MaximaEraseList<MAX_LEN_TO_ERASE> inserted(maxima), to_erase(maxima);
+    MaximaEraseList<MAX_LEN_TO_ERASE, maxima_by_arg_set> inserted_by_arg(maxima_by_arg), to_erase_by_arg(maxima_by_arg);
 
     auto erase_it = function.find(a);
     if (erase_it == std::end(function)) {
         return;
     }
 
-    to_erase.add(maxima.find(*erase_it));
+    to_erase.add(maxima.find(&*erase_it));
+    to_erase_by_arg.add(maxima_by_arg.find(&*erase_it));
 
     try {
         for (auto it : {fun_prev(erase_it, erase_it), fun_next(erase_it, erase_it)}) {
             if (it != std::end(function)) {
-                const auto& [mxit, success] = maxima.insert(*it);
+                const auto& [mxit, success] = maxima.insert(&*it);
                 if (success) {
                     inserted.add(mxit);
                 }
+                const auto& [by_arg_it, by_arg_success] = maxima_by_arg.insert(&*it);
+                if (by_arg_success) {
+                    inserted_by_arg.add(by_arg_it);
+                }
                 if (not refers_to_local_maxima(it, erase_it)) {
                     to_erase.add(mxit);
+                    to_erase_by_arg.add(by_arg_it);
                 }
             }
         }
     } catch (...) {
         inserted.process();
+        inserted_by_arg.process();
         throw;
     }
 
     function.erase(erase_it);
     to_erase.process();
+    to_erase_by_arg.process();
 }
 #endif
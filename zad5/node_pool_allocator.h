@@ -0,0 +1,151 @@
+#ifndef NODE_POOL_ALLOCATOR_H
+#define NODE_POOL_ALLOCATOR_H
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Pool of fixed-size blocks for node-based containers. Blocks are carved out
+// of chunks and returned to a per-size free list on deallocation; memory goes
+// back to the system only when the pool is destroyed. Not thread-safe.
+class NodePool {
+    static constexpr size_t BLOCK_ALIGN = alignof(std::max_align_t);
+    static constexpr size_t MAX_BLOCK_SIZE = 256;
+    static constexpr size_t BLOCKS_PER_CHUNK = 64;
+    static constexpr size_t SIZE_CLASSES = MAX_BLOCK_SIZE / BLOCK_ALIGN;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    FreeBlock* free_lists[SIZE_CLASSES] = {};
+    std::vector<void*> chunks;
+
+    static size_t size_class(size_t bytes) noexcept
+    {
+        return (bytes + BLOCK_ALIGN - 1) / BLOCK_ALIGN - 1;
+    }
+
+    void refill(size_t cls)
+    {
+        size_t block_size = (cls + 1) * BLOCK_ALIGN;
+        chunks.reserve(chunks.size() + 1);
+        char* chunk = static_cast<char*>(::operator new(block_size * BLOCKS_PER_CHUNK));
+        chunks.push_back(chunk);
+        for (size_t i = BLOCKS_PER_CHUNK; i > 0; --i) {
+            auto* block = reinterpret_cast<FreeBlock*>(chunk + (i - 1) * block_size);
+            block->next = free_lists[cls];
+            free_lists[cls] = block;
+        }
+    }
+
+public:
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    ~NodePool()
+    {
+        for (void* chunk : chunks) {
+            ::operator delete(chunk);
+        }
+    }
+
+    void* allocate(size_t bytes, size_t alignment)
+    {
+        if (bytes == 0 or bytes > MAX_BLOCK_SIZE or alignment > BLOCK_ALIGN) {
+            return ::operator new(bytes);
+        }
+        size_t cls = size_class(bytes);
+        if (free_lists[cls] == nullptr) {
+            refill(cls);
+        }
+        FreeBlock* block = free_lists[cls];
+        free_lists[cls] = block->next;
+        return block;
+    }
+
+    void deallocate(void* pointer, size_t bytes, size_t alignment) noexcept
+    {
+        if (bytes == 0 or bytes > MAX_BLOCK_SIZE or alignment > BLOCK_ALIGN) {
+            ::operator delete(pointer);
+            return;
+        }
+        auto* block = static_cast<FreeBlock*>(pointer);
+        size_t cls = size_class(bytes);
+        block->next = free_lists[cls];
+        free_lists[cls] = block;
+    }
+};
+
+// Allocator serving single-node allocations from a shared `NodePool`.
+// Copies (including rebound ones) share the pool, and the pool lives as long
+// as any allocator or container using it. Arrays (n > 1) go to the global
+// allocator. A copied container gets a fresh pool, so copies can be used
+// independently; the allocator propagates on assignment and swap, so
+// copy-and-swap assignment of containers stays valid.
+template <typename T>
+class NodePoolAllocator {
+    std::shared_ptr<NodePool> pool;
+
+    template <typename U>
+    friend class NodePoolAllocator;
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    NodePoolAllocator()
+        : pool(std::make_shared<NodePool>())
+    {
+    }
+
+    // Declared so that moving an allocator copies it; a moved-from container
+    // must still have a pool.
+    NodePoolAllocator(const NodePoolAllocator& other) noexcept = default;
+
+    template <typename U>
+    NodePoolAllocator(const NodePoolAllocator<U>& other) noexcept
+        : pool(other.pool)
+    {
+    }
+
+    NodePoolAllocator select_on_container_copy_construction() const
+    {
+        return NodePoolAllocator();
+    }
+
+    T* allocate(size_t n)
+    {
+        if (n != 1) {
+            return std::allocator<T>().allocate(n);
+        }
+        return static_cast<T*>(pool->allocate(sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t n) noexcept
+    {
+        if (n != 1) {
+            std::allocator<T>().deallocate(pointer, n);
+            return;
+        }
+        pool->deallocate(pointer, sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const NodePoolAllocator<U>& other) const noexcept
+    {
+        return pool == other.pool;
+    }
+
+    template <typename U>
+    bool operator!=(const NodePoolAllocator<U>& other) const noexcept
+    {
+        return pool != other.pool;
+    }
+};
+#endif
@@ -0,0 +1,468 @@
+#ifndef PERSISTENT_FUNCTION_MAXIMA_H
+#define PERSISTENT_FUNCTION_MAXIMA_H
+#include "function_maxima.h"
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Variant of `FunctionMaxima` for one writer and many concurrent readers.
+// Both indexes are persistent treaps: `set_value` and `erase` copy only the
+// nodes on the changed paths, expected O(log n) of them, and publish the new
+// version atomically. `snapshot()` takes the current version in O(1); a
+// snapshot never changes, so it can be iterated while the writer keeps
+// updating.
+//
+// Calls to `set_value`, `erase` and assignment must be serialised by the
+// caller; `snapshot`, `value_at` and `size` may be called from any thread.
+// Versions are published with the atomic `shared_ptr` functions, which
+// libstdc++ implements with a small pool of spin locks, so taking a snapshot
+// is not strictly lock-free; iterating one takes no locks at all.
+//
+// `set_value` and `erase` give the strong guarantee: the new version is built
+// beside the old one, which stays published until it is complete.
+template <typename A, typename V>
+class PersistentFunctionMaxima {
+public:
+    class point_type {
+        A arg_;
+        V value_;
+
+        point_type(const A& arg, const V& value)
+            : arg_(arg)
+            , value_(value)
+        {
+        }
+
+    public:
+        const A& arg() const noexcept
+        {
+            return arg_;
+        }
+
+        const V& value() const noexcept
+        {
+            return value_;
+        }
+        friend class PersistentFunctionMaxima;
+    };
+
+    using size_type = size_t;
+
+private:
+    using point_ptr = std::shared_ptr<const point_type>;
+
+    struct Node;
+    using node_ptr = std::shared_ptr<const Node>;
+
+    // Nodes are never modified once built, so versions can share subtrees.
+    // A point is shared by its nodes in both treaps.
+    struct Node {
+        point_ptr point;
+        node_ptr left;
+        node_ptr right;
+        unsigned priority;
+    };
+
+    struct Version {
+        // Ordered by argument.
+        node_ptr function;
+        // Ordered by value (descending), then argument.
+        node_ptr maxima;
+        size_t size = 0;
+    };
+
+    struct PointArgComp {
+        bool operator()(const point_type& lhs, const point_type& rhs) const
+        {
+            return lhs.arg() < rhs.arg();
+        }
+    };
+
+    struct PointValThenArgComp {
+        bool operator()(const point_type& lhs, const point_type& rhs) const
+        {
+            if (not(lhs.value() < rhs.value()) and not(rhs.value() < lhs.value())) {
+                return lhs.arg() < rhs.arg();
+            } else {
+                return rhs.value() < lhs.value();
+            }
+        }
+    };
+
+public:
+    // In-order iterator over one treap of a snapshot. It stays valid as long
+    // as any snapshot of the same version exists.
+    class tree_iterator {
+        // Nodes whose left subtree has been visited, the current one last.
+        std::vector<const Node*> path;
+
+        void push_left(const Node* node)
+        {
+            for (; node != nullptr; node = node->left.get()) {
+                path.push_back(node);
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = point_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const point_type*;
+        using reference = const point_type&;
+
+        tree_iterator() = default;
+
+        reference operator*() const noexcept
+        {
+            return *path.back()->point;
+        }
+
+        pointer operator->() const noexcept
+        {
+            return path.back()->point.get();
+        }
+
+        tree_iterator& operator++()
+        {
+            const Node* node = path.back();
+            path.pop_back();
+            push_left(node->right.get());
+            return *this;
+        }
+
+        tree_iterator operator++(int)
+        {
+            tree_iterator result(*this);
+            ++(*this);
+            return result;
+        }
+
+        bool operator==(const tree_iterator& other) const noexcept
+        {
+            if (path.empty() or other.path.empty()) {
+                return path.empty() and other.path.empty();
+            }
+            return path.back() == other.path.back();
+        }
+
+        bool operator!=(const tree_iterator& other) const noexcept
+        {
+            return not(*this == other);
+        }
+        friend class PersistentFunctionMaxima;
+    };
+
+    using iterator = tree_iterator;
+    using mx_iterator = tree_iterator;
+
+    // Immutable view of one version, with the read-only interface of
+    // `FunctionMaxima`. Iterators are forward only.
+    class snapshot_type {
+        std::shared_ptr<const Version> version;
+
+        explicit snapshot_type(std::shared_ptr<const Version> version) noexcept
+            : version(std::move(version))
+        {
+        }
+
+    public:
+        const V& value_at(const A& a) const
+        {
+            point_ptr point = find_point(version->function.get(), a);
+            if (point == nullptr) {
+                throw InvalidArg();
+            } else {
+                // The node owning the point lives as long as the snapshot.
+                return point->value();
+            }
+        }
+
+        iterator begin() const
+        {
+            iterator result;
+            result.push_left(version->function.get());
+            return result;
+        }
+
+        iterator end() const noexcept
+        {
+            return iterator();
+        }
+
+        iterator find(const A& a) const
+        {
+            iterator result;
+            const Node* node = version->function.get();
+            while (node != nullptr) {
+                if (a < node->point->arg()) {
+                    result.path.push_back(node);
+                    node = node->left.get();
+                } else if (node->point->arg() < a) {
+                    node = node->right.get();
+                } else {
+                    result.path.push_back(node);
+                    return result;
+                }
+            }
+            return end();
+        }
+
+        mx_iterator mx_begin() const
+        {
+            mx_iterator result;
+            result.push_left(version->maxima.get());
+            return result;
+        }
+
+        mx_iterator mx_end() const noexcept
+        {
+            return mx_iterator();
+        }
+
+        size_type size() const noexcept
+        {
+            return version->size;
+        }
+        friend class PersistentFunctionMaxima;
+    };
+
+private:
+    // Accessed only through `std::atomic_load` and `std::atomic_store`.
+    std::shared_ptr<const Version> version;
+    // Treap priorities; used by the writer only.
+    std::minstd_rand priorities;
+
+    static node_ptr make_node(const point_ptr& point, node_ptr left, node_ptr right, unsigned priority)
+    {
+        return std::make_shared<const Node>(Node { point, std::move(left), std::move(right), priority });
+    }
+
+    // Splits `root` into the points for which `goes_left` holds and the rest.
+    // `goes_left` must hold for a prefix of the treap order.
+    template <typename GoesLeft>
+    static std::pair<node_ptr, node_ptr> split(const node_ptr& root, GoesLeft goes_left)
+    {
+        if (root == nullptr) {
+            return {nullptr, nullptr};
+        }
+        if (goes_left(*root->point)) {
+            auto [left, right] = split(root->right, goes_left);
+            return {make_node(root->point, root->left, std::move(left), root->priority), std::move(right)};
+        } else {
+            auto [left, right] = split(root->left, goes_left);
+            return {std::move(left), make_node(root->point, std::move(right), root->right, root->priority)};
+        }
+    }
+
+    // Every point of `left` must precede every point of `right`.
+    static node_ptr merge(const node_ptr& left, const node_ptr& right)
+    {
+        if (left == nullptr) {
+            return right;
+        }
+        if (right == nullptr) {
+            return left;
+        }
+        if (right->priority < left->priority) {
+            return make_node(left->point, left->left, merge(left->right, right), left->priority);
+        } else {
+            return make_node(right->point, merge(left, right->left), right->right, right->priority);
+        }
+    }
+
+    template <typename Comp>
+    node_ptr tree_insert(const node_ptr& root, const point_ptr& point, Comp comp)
+    {
+        auto [left, right] = split(root, [&](const point_type& p) { return comp(p, *point); });
+        return merge(merge(left, make_node(point, nullptr, nullptr, priorities())), right);
+    }
+
+    template <typename Comp>
+    static node_ptr tree_erase(const node_ptr& root, const point_type& point, Comp comp)
+    {
+        auto [left, rest] = split(root, [&](const point_type& p) { return comp(p, point); });
+        auto [erased, right] = split(rest, [&](const point_type& p) { return not comp(point, p); });
+        return merge(left, right);
+    }
+
+    static point_ptr find_point(const Node* node, const A& a)
+    {
+        while (node != nullptr) {
+            if (a < node->point->arg()) {
+                node = node->left.get();
+            } else if (node->point->arg() < a) {
+                node = node->right.get();
+            } else {
+                return node->point;
+            }
+        }
+        return nullptr;
+    }
+
+    // The point with the largest argument smaller than `a`, or null.
+    static point_ptr prev_point(const Node* node, const A& a)
+    {
+        point_ptr result;
+        while (node != nullptr) {
+            if (node->point->arg() < a) {
+                result = node->point;
+                node = node->right.get();
+            } else {
+                node = node->left.get();
+            }
+        }
+        return result;
+    }
+
+    // The point with the smallest argument greater than `a`, or null.
+    static point_ptr next_point(const Node* node, const A& a)
+    {
+        point_ptr result;
+        while (node != nullptr) {
+            if (a < node->point->arg()) {
+                result = node->point;
+                node = node->left.get();
+            } else {
+                node = node->right.get();
+            }
+        }
+        return result;
+    }
+
+    // Either pointer may be null when there is no neighbour on that side.
+    static bool is_local_maximum(const point_type* left, const point_type& p, const point_type* right)
+    {
+        return (left == nullptr or not(p.value() < left->value()))
+            and (right == nullptr or not(p.value() < right->value()));
+    }
+
+    // Updates the maxima treap for a point whose maximum status may change.
+    node_ptr update_maxima(const node_ptr& maxima, const point_ptr& point, bool was_maximum, bool is_maximum)
+    {
+        if (was_maximum and not is_maximum) {
+            return tree_erase(maxima, *point, PointValThenArgComp());
+        } else if (is_maximum and not was_maximum) {
+            return tree_insert(maxima, point, PointValThenArgComp());
+        } else {
+            return maxima;
+        }
+    }
+
+public:
+    PersistentFunctionMaxima()
+        : version(std::make_shared<const Version>())
+    {
+    }
+
+    // O(1): the copy shares the current version.
+    PersistentFunctionMaxima(const PersistentFunctionMaxima& other)
+        : version(std::atomic_load(&other.version))
+        , priorities(other.priorities)
+    {
+    }
+
+    PersistentFunctionMaxima& operator=(const PersistentFunctionMaxima& other) noexcept
+    {
+        std::atomic_store(&version, std::atomic_load(&other.version));
+        priorities = other.priorities;
+        return (*this);
+    }
+
+    snapshot_type snapshot() const noexcept
+    {
+        return snapshot_type(std::atomic_load(&version));
+    }
+
+    // Returns a copy, since the point may leave the current version at any
+    // time; use a snapshot to read values by reference.
+    V value_at(const A& a) const
+    {
+        return snapshot().value_at(a);
+    }
+
+    void set_value(const A& a, const V& v);
+
+    void erase(const A& a);
+
+    size_type size() const noexcept
+    {
+        return std::atomic_load(&version)->size;
+    }
+};
+
+template <typename A, typename V>
+void PersistentFunctionMaxima<A, V>::set_value(const A& a, const V& v)
+{
+    std::shared_ptr<const Version> current = std::atomic_load(&version);
+    const Node* root = current->function.get();
+
+    point_ptr old_point = find_point(root, a);
+    if (old_point != nullptr and not(v < old_point->value()) and not(old_point->value() < v)) {
+        return;
+    }
+
+    point_ptr point(new point_type(a, v));
+    point_ptr prev = prev_point(root, a);
+    point_ptr next = next_point(root, a);
+    point_ptr prev2 = prev != nullptr ? prev_point(root, prev->arg()) : nullptr;
+    point_ptr next2 = next != nullptr ? next_point(root, next->arg()) : nullptr;
+
+    node_ptr function = current->function;
+    node_ptr maxima = current->maxima;
+    // Neighbours of `prev` and `next` on the side of `a` before the change.
+    const point_type* prev_old_right = old_point != nullptr ? old_point.get() : next.get();
+    const point_type* next_old_left = old_point != nullptr ? old_point.get() : prev.get();
+
+    if (old_point != nullptr) {
+        function = tree_erase(function, *old_point, PointArgComp());
+        maxima = update_maxima(maxima, old_point, is_local_maximum(prev.get(), *old_point, next.get()), false);
+    }
+    function = tree_insert(function, point, PointArgComp());
+    maxima = update_maxima(maxima, point, false, is_local_maximum(prev.get(), *point, next.get()));
+    if (prev != nullptr) {
+        maxima = update_maxima(maxima, prev, is_local_maximum(prev2.get(), *prev, prev_old_right),
+            is_local_maximum(prev2.get(), *prev, point.get()));
+    }
+    if (next != nullptr) {
+        maxima = update_maxima(maxima, next, is_local_maximum(next_old_left, *next, next2.get()),
+            is_local_maximum(point.get(), *next, next2.get()));
+    }
+
+    size_t size = current->size + (old_point != nullptr ? 0 : 1);
+    std::atomic_store(&version, std::make_shared<const Version>(Version { function, maxima, size }));
+}
+
+template <typename A, typename V>
+void PersistentFunctionMaxima<A, V>::erase(const A& a)
+{
+    std::shared_ptr<const Version> current = std::atomic_load(&version);
+    const Node* root = current->function.get();
+
+    point_ptr old_point = find_point(root, a);
+    if (old_point == nullptr) {
+        return;
+    }
+
+    point_ptr prev = prev_point(root, a);
+    point_ptr next = next_point(root, a);
+    point_ptr prev2 = prev != nullptr ? prev_point(root, prev->arg()) : nullptr;
+    point_ptr next2 = next != nullptr ? next_point(root, next->arg()) : nullptr;
+
+    node_ptr function = tree_erase(current->function, *old_point, PointArgComp());
+    node_ptr maxima = update_maxima(current->maxima, old_point,
+        is_local_maximum(prev.get(), *old_point, next.get()), false);
+    if (prev != nullptr) {
+        maxima = update_maxima(maxima, prev, is_local_maximum(prev2.get(), *prev, old_point.get()),
+            is_local_maximum(prev2.get(), *prev, next.get()));
+    }
+    if (next != nullptr) {
+        maxima = update_maxima(maxima, next, is_local_maximum(old_point.get(), *next, next2.get()),
+            is_local_maximum(prev.get(), *next, next2.get()));
+    }
+
+    std::atomic_store(&version, std::make_shared<const Version>(Version { function, maxima, current->size - 1 }));
+}
+#endif